@@ -2,9 +2,12 @@
 #include "altc.h"
 #include <stdio.h>
 #include "posix/inc.h"
+#include "posix/time.h"
 #include "io/output.h"
 #include "io/input.h"
+#include "log.h"
 #include "mem.h"
+#include "prof.h"
 #include "res.h"
 
 
@@ -15,10 +18,15 @@
 _export
 void altc_init()
 {
+	_clock_init();
+	_simd_init();
+	_slab_init();
 	_res_init();
+	_prof_init();
 	io_stdout = io_output_new(_file_stdout, 0);
 	io_stderr = io_output_new(_file_stderr, 0);
 	io_stdin = io_input_new(_file_stdin, 0);
+	_log_init();
 }
 
 /**
@@ -28,8 +36,12 @@ void altc_init()
 _export
 void altc_destroy()
 {
+	_log_destroy();
+	_thrpool_destroy();
 	io_output_close(io_stdout);
 	io_output_close(io_stderr);
 	io_input_close(io_stdin);
+	_prof_destroy();
 	_res_destroy();
+	_slab_destroy();
 }
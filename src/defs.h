@@ -23,6 +23,36 @@
 #	define _test 0
 #endif
 
+/*
+ * allocator definitions
+ */
+
+#if !defined(_slab) && !defined(NOSLAB)
+#	define _slab 1
+#elif !defined(_slab)
+#	define _slab 0
+#endif
+
+#if !defined(_notrack) && defined(NOTRACK)
+#	define _notrack 1
+#elif !defined(_notrack)
+#	define _notrack 0
+#endif
+
+#if _notrack && !_slab
+#	error "Untracked memory requires the slab allocator."
+#endif
+
+/*
+ * lock profiling definitions
+ */
+
+#if !defined(_lockprof) && defined(LOCKPROF)
+#	define _lockprof 1
+#elif !defined(_lockprof)
+#	define _lockprof 0
+#endif
+
 /* 
  * windows check 
  */ 
@@ -41,6 +71,12 @@
 #       define _export __attribute__((visibility("default")))
 #endif
 
+/*
+ * header inline definition, paired with an exported library definition
+ */
+
+#define _inline extern inline __attribute__((gnu_inline))
+
 /*
  * common headers
  */
@@ -65,6 +101,12 @@
 #	define RES_NTRACE	8
 #endif
 
+/*
+ * budget definitions
+ */
+
+#define RES_NOBUDGET	INT64_MAX
+
 
 /**
  * Variable argument list wrapper structure.
@@ -95,4 +137,37 @@ struct _res_node_t {
 #endif
 };
 
+/**
+ * Resource statistics structure. Counts are net values: a resource released
+ * on a thread other than the one that allocated it is subtracted from the
+ * releasing thread, so per-thread counts may be negative.
+ *   @id: The thread identifier, or zero for totals.
+ *   @memcnt: The number of memory resources.
+ *   @nodecnt: The number of general resources.
+ *   @memnbytes: The number of memory bytes, only tracked in debug and test
+ *     builds.
+ */
+
+struct res_stat_t {
+	uint64_t id;
+	int64_t memcnt, nodecnt, memnbytes;
+};
+
+/**
+ * Resource scope usage structure. Bytes are counted where they are
+ * allocated and freed, so freeing memory of an enclosing scope lowers the
+ * count of the current one. Untracked builds count usable sizes.
+ *   @nbytes: The bytes allocated minus the bytes freed while the scope was
+ *     current, including what nested scopes handed up.
+ *   @peak: The highest value of 'nbytes', counting nested scopes.
+ *   @nallocs: The number of allocations, counting nested scopes.
+ *   @budget: The limit on 'nbytes', or 'RES_NOBUDGET'.
+ */
+
+struct res_usage_t {
+	int64_t nbytes, peak;
+	uint64_t nallocs;
+	int64_t budget;
+};
+
 #endif
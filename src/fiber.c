@@ -0,0 +1,516 @@
+#include "common.h"
+#include "fiber.h"
+#include <sys/mman.h>
+#include "mem.h"
+#include "posix/inc.h"
+#include "res.h"
+#include "string.h"
+#include "try.h"
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#	define FIBER_ASM 1
+#else
+#	define FIBER_ASM 0
+#	include <ucontext.h>
+#endif
+
+
+/*
+ * fiber definitions
+ */
+
+#define FIBER_STACK	(64 * 1024)
+#define FIBER_CACHE	64
+
+/**
+ * Fiber structure.
+ *   @sp, caller: The saved stack pointers of the fiber and its resumer.
+ *   @ctx, caller: The saved contexts of the fiber and its resumer.
+ *   @stack, nbytes: The stack mapping, including the guard page.
+ *   @func: The function.
+ *   @value: The value passed by the last resume or yield.
+ *   @error: The error thrown by the function, if any.
+ *   @base, info: The base and current scope of the fiber.
+ *   @outer: The scope of the resumer.
+ *   @prev: The fiber running before this one was resumed.
+ *   @running, done: The running and finished flags.
+ */
+
+struct fiber_t {
+#if FIBER_ASM
+	void *sp, *caller;
+#else
+	ucontext_t ctx, caller;
+#endif
+
+	void *stack;
+	size_t nbytes;
+
+	void *(*func)(void *);
+	void *value;
+	char *error;
+
+	struct res_info_t *base, *info, *outer;
+	struct fiber_t *prev;
+
+	bool running, done;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static void entry(void);
+static void unwind(struct fiber_t *fiber);
+
+static void *stack_new(size_t nbytes);
+static void stack_delete(void *stack, size_t nbytes);
+
+static void ctx_init(struct fiber_t *fiber);
+static void ctx_enter(struct fiber_t *fiber);
+static void ctx_leave(struct fiber_t *fiber);
+
+/*
+ * local variables
+ */
+
+static __thread struct fiber_t *current = NULL;
+
+static _mutex_t cache_lock = _MUTEX_INIT;
+static void *cache[FIBER_CACHE];
+static unsigned int ncache = 0;
+
+
+#if FIBER_ASM
+
+/*
+ * Switch stacks, saving the callee-saved registers on the current stack
+ * and restoring them from the target stack.
+ *   @save: The location to save the current stack pointer.
+ *   @load: The stack pointer to switch to.
+ */
+
+void _fiber_switch(void **save, void *load);
+
+#if defined(__x86_64__)
+__asm__(
+	".text\n"
+	".globl _fiber_switch\n"
+	".hidden _fiber_switch\n"
+	".type _fiber_switch, @function\n"
+	"_fiber_switch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size _fiber_switch, .-_fiber_switch\n"
+);
+#else
+__asm__(
+	".text\n"
+	".globl _fiber_switch\n"
+	".hidden _fiber_switch\n"
+	".type _fiber_switch, %function\n"
+	"_fiber_switch:\n"
+	"	sub sp, sp, #160\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x2, sp\n"
+	"	str x2, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #160\n"
+	"	ret\n"
+	".size _fiber_switch, .-_fiber_switch\n"
+);
+#endif
+
+#endif
+
+
+/**
+ * Create a fiber. The fiber is run by 'fiber_resume' and must only be
+ * resumed on the thread that created it. Stacks of the default size are
+ * cached for reuse.
+ *   @func: The function, taking the value of the first resume.
+ *   @nbytes: The stack size, or zero for the default.
+ *   &returns: The fiber.
+ */
+
+_export
+struct fiber_t *fiber_new(void *(*func)(void *), size_t nbytes)
+{
+	struct fiber_t *fiber;
+
+	if(nbytes == 0)
+		nbytes = FIBER_STACK;
+
+	fiber = mem_alloc(sizeof(struct fiber_t));
+	fiber->nbytes = nbytes;
+	fiber->stack = stack_new(nbytes);
+	fiber->func = func;
+	fiber->value = NULL;
+	fiber->error = NULL;
+	fiber->base = fiber->info = fiber->outer = NULL;
+	fiber->prev = NULL;
+	fiber->running = fiber->done = false;
+
+	ctx_init(fiber);
+
+	return fiber;
+}
+
+/**
+ * Delete a fiber. A suspended fiber is abandoned: its scopes are popped
+ * into the current scope without returning to the fiber.
+ *   @fiber: The fiber.
+ */
+
+_export
+void fiber_delete(struct fiber_t *fiber)
+{
+	if(fiber->running)
+		fatal("Cannot delete a running fiber.");
+
+	if((fiber->base != NULL) && !fiber->done)
+		unwind(fiber);
+
+	if(fiber->error != NULL)
+		free(fiber->error);
+
+	stack_delete(fiber->stack, fiber->nbytes);
+	mem_free(fiber);
+}
+
+
+/**
+ * Resume a fiber until it yields or returns. The fiber has its own chain
+ * of scopes, so 'try', 'throw' and 'res_push' inside the fiber do not
+ * touch the scopes of the resumer. An error thrown out of the fiber
+ * function is thrown again by the resume.
+ *   @fiber: The fiber.
+ *   @value: The value returned by 'fiber_yield' inside the fiber.
+ *   &returns: The value yielded or returned by the fiber.
+ */
+
+_export
+void *fiber_resume(struct fiber_t *fiber, void *value)
+{
+	if(fiber->done)
+		throw("Fiber already finished.");
+	else if(fiber->running)
+		throw("Fiber already running.");
+
+	fiber->value = value;
+	fiber->prev = current;
+	fiber->outer = res_info();
+	fiber->running = true;
+
+	if(fiber->base != NULL)
+		fiber->base->up = fiber->outer;
+
+	current = fiber;
+	_res_current = fiber->info;
+	ctx_enter(fiber);
+	_res_current = fiber->outer;
+	current = fiber->prev;
+
+	fiber->running = false;
+
+	if(fiber->error != NULL) {
+		char msg[str_len(fiber->error) + 1];
+
+		mem_copy(msg, fiber->error, sizeof(msg));
+		free(fiber->error);
+		fiber->error = NULL;
+
+		throw("%s", msg);
+	}
+
+	return fiber->value;
+}
+
+/**
+ * Yield from the current fiber back to its resumer.
+ *   @value: The value returned by 'fiber_resume'.
+ *   &returns: The value passed to the next resume.
+ */
+
+_export
+void *fiber_yield(void *value)
+{
+	struct fiber_t *fiber = current;
+
+	if(fiber == NULL)
+		throw("Cannot yield outside of a fiber.");
+
+	fiber->value = value;
+	fiber->info = res_info();
+	ctx_leave(fiber);
+
+	return fiber->value;
+}
+
+
+/**
+ * Check if a fiber has finished.
+ *   @fiber: The fiber.
+ *   &returns: True if finished.
+ */
+
+_export
+bool fiber_isdone(struct fiber_t *fiber)
+{
+	return fiber->done;
+}
+
+/**
+ * Retrieve the running fiber.
+ *   &returns: The fiber, or null if not in a fiber.
+ */
+
+_export
+struct fiber_t *fiber_current(void)
+{
+	return current;
+}
+
+
+/**
+ * Fiber entry point. The base scope of the fiber is pushed on the scope of
+ * the resumer, sharing its thread record, and is popped into the scope of
+ * whoever resumed the fiber last.
+ */
+
+static void entry(void)
+{
+	struct fiber_t *fiber = current;
+
+	_res_current = fiber->outer;
+	fiber->base = res_push();
+
+	if(try())
+		fiber->value = fiber->func(fiber->value);
+	else {
+		const char *error = errstr;
+
+		fiber->error = malloc(str_len(error) + 1);
+		mem_copy(fiber->error, error, str_len(error) + 1);
+		fiber->value = NULL;
+	}
+
+	while(res_info() != fiber->base)
+		res_pop();
+
+	fiber->base->up = fiber->outer;
+	res_pop();
+
+	fiber->base = fiber->info = NULL;
+	fiber->done = true;
+	ctx_leave(fiber);
+}
+
+/**
+ * Pop the scopes of a suspended fiber into the current scope.
+ *   @fiber: The fiber.
+ */
+
+static void unwind(struct fiber_t *fiber)
+{
+	struct res_info_t *outer = res_info();
+
+	_res_current = fiber->info;
+
+	while(res_info() != fiber->base)
+		res_pop();
+
+	fiber->base->up = outer;
+	res_pop();
+
+	fiber->base = fiber->info = NULL;
+	fiber->done = true;
+}
+
+
+/**
+ * Create a stack with a guard page below it.
+ *   @nbytes: The usable size.
+ *   &returns: The base of the mapping.
+ */
+
+static void *stack_new(size_t nbytes)
+{
+	void *stack = NULL;
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	if(nbytes == FIBER_STACK) {
+		_mutex_lock(&cache_lock);
+
+		if(ncache > 0)
+			stack = cache[--ncache];
+
+		_mutex_unlock(&cache_lock);
+
+		if(stack != NULL)
+			return stack;
+	}
+
+	stack = mmap(NULL, nbytes + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if(stack == MAP_FAILED)
+		throw("Failed to map fiber stack. %s.", strerror(errno));
+
+	if(mprotect(stack, page, PROT_NONE) < 0)
+		fatal("Failed to protect fiber stack. %s.", strerror(errno));
+
+	return stack;
+}
+
+/**
+ * Delete a stack, caching it if it has the default size.
+ *   @stack: The base of the mapping.
+ *   @nbytes: The usable size.
+ */
+
+static void stack_delete(void *stack, size_t nbytes)
+{
+	if(nbytes == FIBER_STACK) {
+		_mutex_lock(&cache_lock);
+
+		if(ncache < FIBER_CACHE) {
+			cache[ncache++] = stack;
+			stack = NULL;
+		}
+
+		_mutex_unlock(&cache_lock);
+
+		if(stack == NULL)
+			return;
+	}
+
+	munmap(stack, nbytes + sysconf(_SC_PAGESIZE));
+}
+
+
+#if FIBER_ASM
+
+/**
+ * Initialize the context of a fiber, laying out a frame on its stack that
+ * '_fiber_switch' restores into a call of 'entry'.
+ *   @fiber: The fiber.
+ */
+
+static void ctx_init(struct fiber_t *fiber)
+{
+	uintptr_t *top;
+
+	top = (uintptr_t *)(((uintptr_t)fiber->stack + sysconf(_SC_PAGESIZE) + fiber->nbytes) & ~(uintptr_t)15);
+
+#if defined(__x86_64__)
+	top -= 9;
+	top[0] = 0x1F80 | ((uintptr_t)0x037F << 32);
+	mem_zero(&top[1], 6 * sizeof(uintptr_t));
+	top[7] = (uintptr_t)entry;
+	top[8] = 0;
+#else
+	top -= 20;
+	mem_zero(top, 20 * sizeof(uintptr_t));
+	top[11] = (uintptr_t)entry;
+#endif
+
+	fiber->sp = top;
+}
+
+/**
+ * Switch from the resumer into a fiber.
+ *   @fiber: The fiber.
+ */
+
+static void ctx_enter(struct fiber_t *fiber)
+{
+	_fiber_switch(&fiber->caller, fiber->sp);
+}
+
+/**
+ * Switch from a fiber back to its resumer.
+ *   @fiber: The fiber.
+ */
+
+static void ctx_leave(struct fiber_t *fiber)
+{
+	_fiber_switch(&fiber->sp, fiber->caller);
+}
+
+#else
+
+/**
+ * Initialize the context of a fiber.
+ *   @fiber: The fiber.
+ */
+
+static void ctx_init(struct fiber_t *fiber)
+{
+	if(getcontext(&fiber->ctx) < 0)
+		fatal("Failed to get context. %s.", strerror(errno));
+
+	fiber->ctx.uc_stack.ss_sp = (uint8_t *)fiber->stack + sysconf(_SC_PAGESIZE);
+	fiber->ctx.uc_stack.ss_size = fiber->nbytes;
+	fiber->ctx.uc_link = NULL;
+	makecontext(&fiber->ctx, entry, 0);
+}
+
+/**
+ * Switch from the resumer into a fiber.
+ *   @fiber: The fiber.
+ */
+
+static void ctx_enter(struct fiber_t *fiber)
+{
+	swapcontext(&fiber->caller, &fiber->ctx);
+}
+
+/**
+ * Switch from a fiber back to its resumer.
+ *   @fiber: The fiber.
+ */
+
+static void ctx_leave(struct fiber_t *fiber)
+{
+	swapcontext(&fiber->ctx, &fiber->caller);
+}
+
+#endif
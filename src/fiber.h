@@ -0,0 +1,17 @@
+#ifndef FIBER_H
+#define FIBER_H
+
+/*
+ * fiber function declarations
+ */
+
+struct fiber_t *fiber_new(void *(*func)(void *), size_t nbytes);
+void fiber_delete(struct fiber_t *fiber);
+
+void *fiber_resume(struct fiber_t *fiber, void *value);
+void *fiber_yield(void *value);
+
+bool fiber_isdone(struct fiber_t *fiber);
+struct fiber_t *fiber_current(void);
+
+#endif
@@ -0,0 +1,618 @@
+#include "common.h"
+#include "future.h"
+#include "mem.h"
+#include "posix/inc.h"
+#include "res.h"
+#include "string.h"
+#include "thrpool.h"
+#include "try.h"
+
+
+/**
+ * Future state enumerator.
+ *   @state_pending_e: Not yet completed.
+ *   @state_resolved_e: Completed with a value.
+ *   @state_rejected_e: Completed with an error.
+ */
+
+enum state_e {
+	state_pending_e,
+	state_resolved_e,
+	state_rejected_e
+};
+
+/**
+ * Listener structure, called with the future locked once it completes.
+ *   @next: The next listener.
+ *   @func: The callback.
+ *   @arg: The callback argument.
+ */
+
+struct listen_t {
+	struct listen_t *next;
+
+	void (*func)(struct future_t *future, void *arg);
+	void *arg;
+};
+
+/**
+ * Future structure.
+ *   @refs: The reference count.
+ *   @state: The state.
+ *   @value: The value, once resolved.
+ *   @error: The error, once rejected.
+ *   @lock: The lock.
+ *   @cond, nwait: The completion condition and its number of waiters.
+ *   @listen: The listener list.
+ */
+
+struct future_t {
+	unsigned int refs;
+
+	enum state_e state;
+	void *value;
+	char *error;
+
+	_mutex_t lock;
+	_cond_t cond;
+	unsigned int nwait;
+	struct listen_t *listen;
+};
+
+/**
+ * Asynchronous call structure.
+ *   @future: The future completed by the call.
+ *   @func: The function.
+ *   @arg: The argument.
+ *   @ret, error: The return value and the error thrown.
+ */
+
+struct async_t {
+	struct future_t *future;
+
+	void *(*func)(void *);
+	void *arg;
+
+	void *ret;
+	char *error;
+};
+
+/**
+ * Continuation structure.
+ *   @listen: The listener on the source future.
+ *   @future: The future completed by the continuation.
+ *   @pool: The pool.
+ *   @func: The function.
+ *   @arg, value: The argument and the value of the source future.
+ *   @ret, error: The return value and the error thrown.
+ */
+
+struct then_t {
+	struct listen_t listen;
+	struct future_t *future;
+
+	struct thrpool_t *pool;
+	void *(*func)(void *, void *);
+	void *arg, *value;
+
+	void *ret;
+	char *error;
+};
+
+/**
+ * Any waiter structure.
+ *   @lock: The lock.
+ *   @cond: The condition.
+ *   @done: The completion flag.
+ */
+
+struct any_t {
+	_mutex_t lock;
+	_cond_t cond;
+	bool done;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static void complete(struct future_t *future, void *value, char *error);
+static bool settle(struct future_t *future, void *value, char *error);
+static void await(struct future_t *future);
+static struct thrpool_t *getpool(struct thrpool_t *pool);
+static char *errdup(const char *str);
+
+static void *async_proc(void *arg);
+static void then_fire(struct future_t *future, void *arg);
+static void *then_proc(void *arg);
+static void any_fire(struct future_t *future, void *arg);
+
+
+/**
+ * Create a pending future.
+ *   &returns: The future, holding one reference.
+ */
+
+_export
+struct future_t *future_new(void)
+{
+	struct future_t *future;
+
+	future = malloc(sizeof(struct future_t));
+	future->refs = 1;
+	future->state = state_pending_e;
+	future->value = NULL;
+	future->error = NULL;
+	future->lock = _mutex_init();
+	_mutex_name(&future->lock, "future");
+	future->cond = _cond_init();
+	future->nwait = 0;
+	future->listen = NULL;
+
+	return future;
+}
+
+/**
+ * Add a reference to a future.
+ *   @future: The future.
+ *   &returns: The future.
+ */
+
+_export
+struct future_t *future_ref(struct future_t *future)
+{
+	__atomic_add_fetch(&future->refs, 1, __ATOMIC_RELAXED);
+
+	return future;
+}
+
+/**
+ * Release a reference to a future, deleting it with the last reference.
+ * A future deleted while pending is rejected first, so its continuations
+ * reject their futures instead of never completing.
+ *   @future: The future.
+ */
+
+_export
+void future_delete(struct future_t *future)
+{
+	if(__atomic_sub_fetch(&future->refs, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	if(future->state == state_pending_e)
+		settle(future, NULL, errdup("Source future deleted."));
+
+	_cond_destroy(&future->cond);
+	_mutex_destroy(&future->lock);
+
+	if(future->error != NULL)
+		free(future->error);
+
+	free(future);
+}
+
+
+/**
+ * Resolve a future with a value.
+ *   @future: The future.
+ *   @value: The value.
+ */
+
+_export
+void future_resolve(struct future_t *future, void *value)
+{
+	complete(future, value, NULL);
+}
+
+/**
+ * Reject a future with an error.
+ *   @future: The future.
+ *   @format: The printf-style format of the error.
+ *   @...: The printf-style arguments.
+ */
+
+_export
+void future_reject(struct future_t *future, const char *restrict format, ...)
+{
+	char *error;
+	va_list args;
+
+	va_start(args, format);
+	error = malloc(str_vlprintf(format, args) + 1);
+	va_end(args);
+
+	va_start(args, format);
+	str_vprintf(error, format, args);
+	va_end(args);
+
+	complete(future, NULL, error);
+}
+
+
+/**
+ * Run a function asynchronously on a pool. The future resolves with the
+ * value returned by the function, or is rejected with the error it throws.
+ *   @pool: Optional. The pool, defaulting to the current or global pool.
+ *   @func: The function.
+ *   @arg: The argument.
+ *   &returns: The future.
+ */
+
+_export
+struct future_t *future_async(struct thrpool_t *pool, void *(*func)(void *), void *arg)
+{
+	struct async_t *async;
+	struct future_t *future;
+
+	future = future_new();
+
+	async = malloc(sizeof(struct async_t));
+	*async = (struct async_t){ future_ref(future), func, arg, NULL, NULL };
+	thrpool_spawn(getpool(pool), async_proc, async);
+
+	return future;
+}
+
+/**
+ * Chain a continuation to a future. Once the future resolves, the function
+ * is called on a pool with its value; if the future is rejected, the error
+ * passes to the new future without calling the function.
+ *   @future: The future.
+ *   @pool: Optional. The pool, defaulting to the current or global pool.
+ *   @func: The function, taking the value and the argument.
+ *   @arg: The argument.
+ *   &returns: The new future.
+ */
+
+_export
+struct future_t *future_then(struct future_t *future, struct thrpool_t *pool, void *(*func)(void *, void *), void *arg)
+{
+	struct then_t *then;
+	struct future_t *next;
+
+	next = future_new();
+
+	then = malloc(sizeof(struct then_t));
+	*then = (struct then_t){ { NULL, then_fire, then }, future_ref(next), getpool(pool), func, arg, NULL, NULL, NULL };
+
+	_mutex_lock(&future->lock);
+
+	if(future->state == state_pending_e) {
+		then->listen.next = future->listen;
+		future->listen = &then->listen;
+		_mutex_unlock(&future->lock);
+	}
+	else {
+		_mutex_unlock(&future->lock);
+		then_fire(future, then);
+	}
+
+	return next;
+}
+
+
+/**
+ * Check if a future has completed.
+ *   @future: The future.
+ *   &returns: True if resolved or rejected.
+ */
+
+_export
+bool future_isdone(struct future_t *future)
+{
+	return __atomic_load_n(&future->state, __ATOMIC_ACQUIRE) != state_pending_e;
+}
+
+/**
+ * Wait for a future to complete. A pool worker runs other tasks while it
+ * waits.
+ *   @future: The future.
+ *   &returns: The value, or throws the error if rejected.
+ */
+
+_export
+void *future_wait(struct future_t *future)
+{
+	await(future);
+
+	if(future->state == state_rejected_e)
+		throw("%s", future->error);
+
+	return future->value;
+}
+
+/**
+ * Wait for all futures to complete. If any was rejected, the error of the
+ * first rejected future is thrown.
+ *   @list: The future list.
+ *   @cnt: The number of futures.
+ */
+
+_export
+void future_wait_all(struct future_t **list, unsigned int cnt)
+{
+	unsigned int i;
+
+	for(i = 0; i < cnt; i++)
+		await(list[i]);
+
+	for(i = 0; i < cnt; i++) {
+		if(list[i]->state == state_rejected_e)
+			throw("%s", list[i]->error);
+	}
+}
+
+/**
+ * Wait for any future to complete.
+ *   @list: The future list, not empty.
+ *   @cnt: The number of futures.
+ *   &returns: The index of the first completed future.
+ */
+
+_export
+unsigned int future_wait_any(struct future_t **list, unsigned int cnt)
+{
+	unsigned int i, n;
+	struct any_t any;
+	struct listen_t listen[cnt], **iter;
+
+	if(thrpool_current() != NULL) {
+		while(true) {
+			for(i = 0; i < cnt; i++) {
+				if(future_isdone(list[i]))
+					return i;
+			}
+
+			if(!_thrpool_help())
+				_thread_yield();
+		}
+	}
+
+	any.lock = _mutex_init();
+	any.cond = _cond_init();
+	any.done = false;
+
+	for(n = 0; n < cnt; n++) {
+		_mutex_lock(&list[n]->lock);
+
+		if(list[n]->state != state_pending_e) {
+			_mutex_unlock(&list[n]->lock);
+			break;
+		}
+
+		listen[n] = (struct listen_t){ list[n]->listen, any_fire, &any };
+		list[n]->listen = &listen[n];
+		_mutex_unlock(&list[n]->lock);
+	}
+
+	if(n == cnt) {
+		_mutex_lock(&any.lock);
+
+		while(!any.done)
+			_cond_wait(&any.cond, &any.lock);
+
+		_mutex_unlock(&any.lock);
+	}
+
+	for(i = 0; i < n; i++) {
+		_mutex_lock(&list[i]->lock);
+
+		for(iter = &list[i]->listen; *iter != NULL; iter = &(*iter)->next) {
+			if(*iter == &listen[i]) {
+				*iter = listen[i].next;
+				break;
+			}
+		}
+
+		_mutex_unlock(&list[i]->lock);
+	}
+
+	_cond_destroy(&any.cond);
+	_mutex_destroy(&any.lock);
+
+	for(i = 0; i < cnt; i++) {
+		if(future_isdone(list[i]))
+			break;
+	}
+
+	return i;
+}
+
+
+/**
+ * Complete a future, throwing if it has already completed.
+ *   @future: The future.
+ *   @value: The value.
+ *   @error: The error, taken by the future, or null to resolve.
+ */
+
+static void complete(struct future_t *future, void *value, char *error)
+{
+	if(!settle(future, value, error))
+		throw("Future already completed.");
+}
+
+/**
+ * Settle a future, waking its waiters and calling its listeners. A result
+ * for a future that has already completed is dropped, so internal callers
+ * never throw while their own error handler is armed.
+ *   @future: The future.
+ *   @value: The value.
+ *   @error: The error, taken by the future, or null to resolve.
+ *   &returns: True if settled, false if already completed.
+ */
+
+static bool settle(struct future_t *future, void *value, char *error)
+{
+	struct listen_t *listen, *next;
+
+	_mutex_lock(&future->lock);
+
+	if(future->state != state_pending_e) {
+		_mutex_unlock(&future->lock);
+
+		if(error != NULL)
+			free(error);
+
+		return false;
+	}
+
+	future->value = value;
+	future->error = error;
+	__atomic_store_n(&future->state, error ? state_rejected_e : state_resolved_e, __ATOMIC_RELEASE);
+
+	if(future->nwait > 0)
+		_cond_broadcast(&future->cond);
+
+	for(listen = future->listen; listen != NULL; listen = next) {
+		next = listen->next;
+		listen->func(future, listen->arg);
+	}
+
+	future->listen = NULL;
+
+	_mutex_unlock(&future->lock);
+
+	return true;
+}
+
+/**
+ * Wait for a future to complete without throwing.
+ *   @future: The future.
+ */
+
+static void await(struct future_t *future)
+{
+	if(thrpool_current() != NULL) {
+		while(!future_isdone(future)) {
+			if(!_thrpool_help())
+				_thread_yield();
+		}
+	}
+	else if(!future_isdone(future)) {
+		_mutex_lock(&future->lock);
+		future->nwait++;
+
+		while(future->state == state_pending_e)
+			_cond_wait(&future->cond, &future->lock);
+
+		future->nwait--;
+		_mutex_unlock(&future->lock);
+	}
+}
+
+/**
+ * Select the pool for a call.
+ *   @pool: Optional. The requested pool.
+ *   &returns: The pool.
+ */
+
+static struct thrpool_t *getpool(struct thrpool_t *pool)
+{
+	if(pool == NULL)
+		pool = thrpool_current();
+
+	if(pool == NULL)
+		pool = thrpool_global();
+
+	return pool;
+}
+
+/**
+ * Duplicate an error string.
+ *   @str: The string.
+ *   &returns: The duplicate, freed with 'free'.
+ */
+
+static char *errdup(const char *str)
+{
+	char *error;
+
+	error = malloc(str_len(str) + 1);
+	mem_copy(error, str, str_len(str) + 1);
+
+	return error;
+}
+
+
+/**
+ * Asynchronous call processing function.
+ *   @arg: The call.
+ *   &returns: Always null.
+ */
+
+static void *async_proc(void *arg)
+{
+	struct async_t *async = arg;
+
+	if(try())
+		async->ret = async->func(async->arg);
+	else
+		async->error = errdup(errstr);
+
+	settle(async->future, async->ret, async->error);
+	future_delete(async->future);
+	free(async);
+
+	return NULL;
+}
+
+/**
+ * Fire a continuation once its source future completes.
+ *   @future: The source future.
+ *   @arg: The continuation.
+ */
+
+static void then_fire(struct future_t *future, void *arg)
+{
+	struct then_t *then = arg;
+
+	if(future->state == state_rejected_e) {
+		settle(then->future, NULL, errdup(future->error));
+		future_delete(then->future);
+		free(then);
+	}
+	else {
+		then->value = future->value;
+		thrpool_spawn(then->pool, then_proc, then);
+	}
+}
+
+/**
+ * Continuation processing function.
+ *   @arg: The continuation.
+ *   &returns: Always null.
+ */
+
+static void *then_proc(void *arg)
+{
+	struct then_t *then = arg;
+
+	if(try())
+		then->ret = then->func(then->value, then->arg);
+	else
+		then->error = errdup(errstr);
+
+	settle(then->future, then->ret, then->error);
+	future_delete(then->future);
+	free(then);
+
+	return NULL;
+}
+
+/**
+ * Wake an any waiter once one of its futures completes.
+ *   @future: The completed future.
+ *   @arg: The any waiter.
+ */
+
+static void any_fire(struct future_t *future, void *arg)
+{
+	struct any_t *any = arg;
+
+	_mutex_lock(&any->lock);
+	any->done = true;
+	_cond_signal(&any->cond);
+	_mutex_unlock(&any->lock);
+}
@@ -0,0 +1,29 @@
+#ifndef FUTURE_H
+#define FUTURE_H
+
+/*
+ * structure prototypes
+ */
+
+struct thrpool_t;
+
+/*
+ * future function declarations
+ */
+
+struct future_t *future_new(void);
+struct future_t *future_ref(struct future_t *future);
+void future_delete(struct future_t *future);
+
+void future_resolve(struct future_t *future, void *value);
+void future_reject(struct future_t *future, const char *restrict format, ...);
+
+struct future_t *future_async(struct thrpool_t *pool, void *(*func)(void *), void *arg);
+struct future_t *future_then(struct future_t *future, struct thrpool_t *pool, void *(*func)(void *, void *), void *arg);
+
+bool future_isdone(struct future_t *future);
+void *future_wait(struct future_t *future);
+void future_wait_all(struct future_t **list, unsigned int cnt);
+unsigned int future_wait_any(struct future_t **list, unsigned int cnt);
+
+#endif
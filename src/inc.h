@@ -14,14 +14,84 @@
 #include <string.h>
 
 
+/**
+ * Memory node sturcture. Memory nodes form a circular list per scope, so a
+ * node is unlinked without knowing its scope. Blocks carved from an arena
+ * are not linked; their previous pointer holds the owning scope with the
+ * low bit set and their next pointer holds the number of bytes. When memory
+ * is untracked, only arena blocks have a node. The node is padded to keep
+ * the memory that follows it aligned.
+ *   @prev, next: The previous and next memory nodes.
+ *   @owner: The owning thread, reused as the return stack link once the
+ *     node is freed from another thread.
+ *   @nbytes: The number of bytes.
+ *   @seq: The sequence number of the scope that added the node, truncated.
+ *   @trace: The trace.
+ */
+
+struct _res_mem_t {
+	struct _res_mem_t *prev, *next;
+	void *owner;
+
+	uint64_t nbytes : 40, seq : 24;
+
+#if _debug
+	void *trace[RES_NTRACE];
+#endif
+} __attribute__((aligned(16)));
+
+/*
+ * error record definitions
+ */
+
+#define RES_NARGS	8
+#define RES_STRLEN	256
+
+/**
+ * Error record structure. A throw captures its arguments here without
+ * allocating, and the message is only rendered once it is read. String
+ * arguments are copied since they may not survive the unwind.
+ *   @code: The error code.
+ *   @file: The source file.
+ *   @line: The source line.
+ *   @format: The format, or null if there is nothing to render.
+ *   @nargs, nstr: The number of arguments and of string bytes.
+ *   @spec: The specifier of each argument.
+ *   @args: The captured arguments.
+ *   @str: The copied strings.
+ */
+
+struct _res_err_t {
+	int code;
+	const char *file;
+	unsigned long line;
+	const char *format;
+
+	unsigned int nargs, nstr;
+	char spec[RES_NARGS];
+	union {
+		int i;
+		double f;
+		const void *p;
+	} args[RES_NARGS];
+	char str[RES_STRLEN];
+};
+
 /**
  * Resource information structure.
  *   @up: The previous information structure.
  *   @fatal: The fatal flag.
- *   @error: The error string.
+ *   @error: The rendered error string.
+ *   @err: The error record.
  *   @jmpbuf: The jump buffer.
- *   @mhead, mtail: Memory resource head and tail nodes.
+ *   @thread: The thread record.
+ *   @seq: The scope sequence number, increasing with each push.
+ *   @mem: The memory resource list sentinel.
  *   @nhead, ntail: General resource head and tail nodes.
+ *   @arena, nofree: The arena and no-free flags.
+ *   @chunk: The arena chunk list, most recent first.
+ *   @cur, end: The arena bump pointer and its limit.
+ *   @usage: The memory usage and budget.
  */
 
 struct res_info_t {
@@ -29,31 +99,75 @@ struct res_info_t {
 
 	bool fatal;
 	char *error;
+	struct _res_err_t err;
 	jmp_buf jmpbuf;
 
-	struct _res_mem_t *mhead, *mtail;
+	struct _res_thread_t *thread;
+	uint32_t seq;
+	struct _res_mem_t mem;
 	struct _res_node_t *nhead, *ntail;
+
+	bool arena, nofree;
+	struct _res_chunk_t *chunk;
+	uint8_t *cur, *end;
+
+	struct res_usage_t usage;
 };
 
 /**
- * Memory node sturcture.
- *   @prev, next: The previous and next memory nodes.
- *   @nbytes: The number of bytes.
- *   @trace: The trace.
+ * Retrieve the scope whose list holds a memory node. The node belongs to
+ * the innermost scope pushed before it was added, since popped scopes pass
+ * their memory up. Sequence numbers are compared modulo the node's field.
+ *   @info: The current scope.
+ *   @mem: The memory node, owned by the current thread.
+ *   &returns: The holding scope.
  */
 
-struct _res_mem_t {
-	struct _res_mem_t *prev, *next;
+static inline struct res_info_t *_res_holder(struct res_info_t *info, struct _res_mem_t *mem)
+{
+	while((info->up != NULL) && (((mem->seq - info->seq) & 0xFFFFFF) >= 0x800000))
+		info = info->up;
 
-#if _debug || _test
-	size_t nbytes;
-#endif
+	return info;
+}
 
-#if _debug
-	void *trace[RES_NTRACE];
-#endif
+/**
+ * Thread record structure. Each thread updates only its own counters, so
+ * no lock is needed on the allocation path; readers sum the records. Memory
+ * freed by other threads is pushed onto the return stack and reclaimed by
+ * the owner in batches.
+ *   @prev, next: The previous and next records.
+ *   @stat: The thread statistics.
+ *   @ret: The return stack.
+ *   @orphan: The list sentinel of memory left when the thread exited.
+ *   @sample: The number of bytes until the next profiler sample.
+ *   @seed: The profiler random state, zero until first used.
+ *   @seq: The next scope sequence number.
+ */
+
+struct _res_thread_t {
+	struct _res_thread_t *prev, *next;
+
+	struct res_stat_t stat;
+
+	struct _res_mem_t *ret;
+	struct _res_mem_t orphan;
+
+	int64_t sample;
+	uint64_t seed;
+	uint32_t seq;
 };
 
+/**
+ * Arena chunk structure.
+ *   @next: The next chunk.
+ *   @nbytes: The number of usable bytes.
+ */
+
+struct _res_chunk_t {
+	struct _res_chunk_t *next;
+	size_t nbytes;
+};
 
 /*
  * resource function declarations
@@ -62,7 +176,159 @@ struct _res_mem_t {
 void _res_init();
 void _res_destroy();
 
+void _res_enter(void);
+void _res_leave(void);
+
 void _res_add(struct _res_mem_t *mem, size_t nbytes);
-void _res_remove(struct _res_mem_t *mem);
+bool _res_remove(struct _res_mem_t *mem);
+
+void *_res_carve(struct res_info_t *info, size_t nbytes);
+void _res_uncarve(struct _res_mem_t *mem);
+void *_res_recarve(struct _res_mem_t *mem, size_t nbytes);
+
+/**
+ * Update a thread counter. Only the owning thread writes its counters, so a
+ * relaxed store suffices for concurrent readers.
+ *   @ptr: The counter.
+ *   @val: The value to add.
+ */
+
+static inline void _res_stat(int64_t *ptr, int64_t val)
+{
+	__atomic_store_n(ptr, *ptr + val, __ATOMIC_RELAXED);
+}
+
+/**
+ * Check if a memory block was carved from an arena.
+ *   @mem: The memory node.
+ *   &returns: True if carved from an arena.
+ */
+
+static inline bool _res_iscarved(struct _res_mem_t *mem)
+{
+	return (uintptr_t)mem->prev & 1;
+}
+
+
+/*
+ * error function declarations
+ */
+
+void _try_render(struct res_info_t *info);
+
+
+/*
+ * thread pool structure prototypes
+ */
+
+struct thrtask_t;
+
+/*
+ * thread pool function declarations
+ */
+
+void _thrpool_destroy(void);
+char *_thrpool_join(struct thrtask_t *task, void **ret);
+bool _thrpool_help(void);
+
+
+/*
+ * lock profiling definitions
+ */
+
+#define LOCKPROF_BINS	40
+
+/**
+ * Lock statistics structure. Counters are updated by the lock holder, apart
+ * from failed attempts. Statistics of destroyed locks are merged by name.
+ *   @prev, next: The previous and next statistics in the global list.
+ *   @name: The name, or null if unnamed.
+ *   @addr: The lock address, or null once destroyed.
+ *   @acquires, contended, failed: The number of acquisitions, contended
+ *     acquisitions and failed attempts.
+ *   @wait, hold: The total wait and hold times in nanoseconds.
+ *   @maxwait, maxhold: The longest wait and hold times.
+ *   @hist: The wait time histogram, bin 'i' counting waits below '2^i'.
+ */
+
+struct _lockstat_t {
+	struct _lockstat_t *prev, *next;
+	const char *name;
+	const void *addr;
+
+	uint64_t acquires, contended, failed;
+	uint64_t wait, hold, maxwait, maxhold;
+	uint64_t hist[LOCKPROF_BINS];
+};
+
+/*
+ * lock profiling function declarations
+ */
+
+struct _lockstat_t *_lockstat_snapshot(unsigned int *cnt);
+
+
+/*
+ * slab function declarations
+ */
+
+#if _slab
+void _slab_init(void);
+void _slab_destroy(void);
+
+void *_slab_alloc(size_t nbytes);
+void *_slab_realloc(void *ptr, size_t nbytes);
+void _slab_free(void *ptr);
+size_t _slab_size(void *ptr);
+size_t _slab_round(size_t nbytes);
+
+void *_slab_span(size_t nbytes);
+void _slab_unspan(void *ptr);
+bool _slab_isspan(void *ptr);
+#else
+#	define _slab_init()
+#	define _slab_destroy()
+#	define _slab_alloc malloc
+#	define _slab_realloc realloc
+#	define _slab_free free
+#	define _slab_size malloc_usable_size
+#	define _slab_round(nbytes) (nbytes)
+#	include <malloc.h>
+#endif
+
+
+/*
+ * simd variables
+ */
+
+extern void (*_simd_swap)(void *left, void *right, size_t nbytes);
+extern void (*_simd_case)(char *str, char lo);
+extern const char *(*_simd_prefixi)(const char *left, const char *right);
+extern const char *(*_simd_wbrk)(const char *str);
+extern bool (*_simd_iszero)(const void *ptr, size_t nbytes);
+extern size_t (*_simd_hex_enc)(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+extern size_t (*_simd_base64_enc)(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+extern size_t (*_simd_base64_dec)(uint8_t *restrict dest, const char *restrict src, size_t len);
+extern size_t (*_simd_bswap16)(void *dest, const void *src, size_t cnt);
+extern size_t (*_simd_bswap32)(void *dest, const void *src, size_t cnt);
+extern size_t (*_simd_bswap64)(void *dest, const void *src, size_t cnt);
+
+/*
+ * simd function declarations
+ */
+
+void _simd_init(void);
+
+#if defined(__x86_64__)
+size_t _hex_enc_ssse3(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+size_t _hex_enc_avx2(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+size_t _base64_enc_ssse3(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+size_t _base64_enc_avx2(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+size_t _base64_dec_ssse3(uint8_t *restrict dest, const char *restrict src, size_t len);
+size_t _base64_dec_avx2(uint8_t *restrict dest, const char *restrict src, size_t len);
+size_t _bswap16_ssse3(void *dest, const void *src, size_t cnt);
+size_t _bswap32_ssse3(void *dest, const void *src, size_t cnt);
+size_t _bswap64_ssse3(void *dest, const void *src, size_t cnt);
+#endif
 
 #endif
@@ -3,6 +3,7 @@
 #include "../types/inc.h"
 #include "../mem.h"
 #include "../string.h"
+#include "codec.h"
 #include "device.h"
 #include "output.h"
 #include "print.h"
@@ -19,6 +20,9 @@ static void tab_proc(struct io_output_t output, void *arg);
 static void quote_proc(struct io_output_t output, void *arg);
 static size_t quote_write(void *ref, const void *restrict buf, size_t nbytes);
 
+static void hex_proc(struct io_output_t output, void *arg);
+static void base64_proc(struct io_output_t output, void *arg);
+
 static bool len_ctrl(size_t *len, unsigned int cmd, void *data);
 static size_t len_write(size_t *len, const void *restrict buf, size_t nbytes);
 
@@ -164,6 +168,70 @@ static size_t quote_write(void *ref, const void *restrict buf, size_t nbytes)
 	return nbytes;
 }
 
+/**
+ * Create a hexadecimal chunk.
+ *   @buf: The binary buffer.
+ *   &returns: The chunk.
+ */
+
+_export
+struct io_chunk_t io_chunk_hex(const struct io_chunk_buf_t *buf)
+{
+	return (struct io_chunk_t){ hex_proc, (void *)buf };
+}
+
+/**
+ * Processing callback for hexadecimal chunks.
+ *   @output: The output.
+ *   @arg: The argument.
+ */
+
+static void hex_proc(struct io_output_t output, void *arg)
+{
+	size_t n;
+	char str[IO_HEX_LEN(512)];
+	const struct io_chunk_buf_t *buf = arg;
+	const uint8_t *ptr = buf->buf, *end = ptr + buf->nbytes;
+
+	while(ptr < end) {
+		n = ((end - ptr) < 512) ? (end - ptr) : 512;
+		io_output_full(output, str, io_hex_enc(str, ptr, n));
+		ptr += n;
+	}
+}
+
+/**
+ * Create a base64 chunk.
+ *   @buf: The binary buffer.
+ *   &returns: The chunk.
+ */
+
+_export
+struct io_chunk_t io_chunk_base64(const struct io_chunk_buf_t *buf)
+{
+	return (struct io_chunk_t){ base64_proc, (void *)buf };
+}
+
+/**
+ * Processing callback for base64 chunks.
+ *   @output: The output.
+ *   @arg: The argument.
+ */
+
+static void base64_proc(struct io_output_t output, void *arg)
+{
+	size_t n;
+	char str[IO_BASE64_LEN(768)];
+	const struct io_chunk_buf_t *buf = arg;
+	const uint8_t *ptr = buf->buf, *end = ptr + buf->nbytes;
+
+	while(ptr < end) {
+		n = ((end - ptr) < 768) ? (end - ptr) : 768;
+		io_output_full(output, str, io_base64_enc(str, ptr, n));
+		ptr += n;
+	}
+}
+
 
 /**
  * Process a chunk, retrieve the total length written.
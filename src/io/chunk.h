@@ -1,6 +1,18 @@
 #ifndef IO_CHUNK_H
 #define IO_CHUNK_H
 
+/**
+ * Binary buffer chunk structure.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+struct io_chunk_buf_t {
+	const void *buf;
+	size_t nbytes;
+};
+
+
 /*
  * chunk function declarations
  */
@@ -9,6 +21,8 @@ struct io_chunk_t io_chunk_str(const char *str);
 struct io_chunk_t io_chunk_space(intptr_t cnt);
 struct io_chunk_t io_chunk_tab(intptr_t cnt);
 struct io_chunk_t io_chunk_quote(const struct io_chunk_t *chunk);
+struct io_chunk_t io_chunk_hex(const struct io_chunk_buf_t *buf);
+struct io_chunk_t io_chunk_base64(const struct io_chunk_buf_t *buf);
 
 size_t io_chunk_proc_len(struct io_chunk_t chunk);
 void io_chunk_proc_str(struct io_chunk_t chunk, char *restrict str);
@@ -17,6 +31,8 @@ char *io_chunk_proc_strdup(struct io_chunk_t chunk);
 
 #define io_chunk_quoteval(chunk) io_chunk_quote(mem_getref(struct io_chunk_t, chunk))
 #define io_chunk_quotestr(str) io_chunk_quoteval(io_chunk_str(str))
+#define io_chunk_hexval(buf, nbytes) io_chunk_hex(mem_getref(struct io_chunk_buf_t, ((struct io_chunk_buf_t){ buf, nbytes })))
+#define io_chunk_base64val(buf, nbytes) io_chunk_base64(mem_getref(struct io_chunk_buf_t, ((struct io_chunk_buf_t){ buf, nbytes })))
 
 /**
  * Process a chunk.
@@ -0,0 +1,434 @@
+#include "../common.h"
+#include "codec.h"
+#include "../try.h"
+
+#if defined(__x86_64__)
+#	include <immintrin.h>
+#endif
+
+
+/*
+ * local function declarations
+ */
+
+static int8_t hex_val(char ch);
+static int8_t base64_val(char ch);
+
+
+/*
+ * local variables
+ */
+
+static const char hex_digits[16] = "0123456789abcdef";
+static const char base64_digits[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/**
+ * Encode data as lowercase hexadecimal.
+ *   @dest: The destination, with room for 'IO_HEX_LEN(nbytes)' characters.
+ *   @src: The source data.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of characters written.
+ */
+
+_export
+size_t io_hex_enc(char *restrict dest, const void *restrict src, size_t nbytes)
+{
+	size_t i;
+	const uint8_t *ptr = src;
+
+	i = _simd_hex_enc(dest, ptr, nbytes);
+
+	for(; i < nbytes; i++) {
+		dest[2 * i] = hex_digits[ptr[i] >> 4];
+		dest[2 * i + 1] = hex_digits[ptr[i] & 0x0F];
+	}
+
+	return 2 * nbytes;
+}
+
+/**
+ * Decode hexadecimal data. Both upper and lowercase digits are accepted.
+ *   @dest: The destination, with room for 'len / 2' bytes.
+ *   @src: The source characters.
+ *   @len: The number of characters.
+ *   &returns: The number of bytes written.
+ */
+
+_export
+size_t io_hex_dec(void *restrict dest, const char *restrict src, size_t len)
+{
+	size_t i;
+	int8_t hi, lo;
+	uint8_t *ptr = dest;
+
+	if(len % 2 != 0)
+		throw("Invalid hexadecimal length.");
+
+	for(i = 0; i < len; i += 2) {
+		hi = hex_val(src[i]);
+		lo = hex_val(src[i + 1]);
+		if((hi < 0) || (lo < 0))
+			throw("Invalid hexadecimal data.");
+
+		*ptr++ = (hi << 4) | lo;
+	}
+
+	return len / 2;
+}
+
+/**
+ * Retrieve the value of a hexadecimal digit.
+ *   @ch: The character.
+ *   &returns: The value or '-1' if invalid.
+ */
+
+static int8_t hex_val(char ch)
+{
+	if((ch >= '0') && (ch <= '9'))
+		return ch - '0';
+	else if((ch >= 'a') && (ch <= 'f'))
+		return ch - 'a' + 10;
+	else if((ch >= 'A') && (ch <= 'F'))
+		return ch - 'A' + 10;
+	else
+		return -1;
+}
+
+
+/**
+ * Encode data as padded base64.
+ *   @dest: The destination, with room for 'IO_BASE64_LEN(nbytes)' characters.
+ *   @src: The source data.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of characters written.
+ */
+
+_export
+size_t io_base64_enc(char *restrict dest, const void *restrict src, size_t nbytes)
+{
+	uint32_t val;
+	size_t i, o;
+	const uint8_t *ptr = src;
+
+	i = _simd_base64_enc(dest, ptr, nbytes);
+
+	for(o = i / 3 * 4; i + 3 <= nbytes; i += 3, o += 4) {
+		val = ((uint32_t)ptr[i] << 16) | ((uint32_t)ptr[i + 1] << 8) | ptr[i + 2];
+		dest[o] = base64_digits[val >> 18];
+		dest[o + 1] = base64_digits[(val >> 12) & 0x3F];
+		dest[o + 2] = base64_digits[(val >> 6) & 0x3F];
+		dest[o + 3] = base64_digits[val & 0x3F];
+	}
+
+	if(i < nbytes) {
+		val = (uint32_t)ptr[i] << 16;
+		if(i + 1 < nbytes)
+			val |= (uint32_t)ptr[i + 1] << 8;
+
+		dest[o] = base64_digits[val >> 18];
+		dest[o + 1] = base64_digits[(val >> 12) & 0x3F];
+		dest[o + 2] = (i + 1 < nbytes) ? base64_digits[(val >> 6) & 0x3F] : '=';
+		dest[o + 3] = '=';
+		o += 4;
+	}
+
+	return o;
+}
+
+/**
+ * Decode padded base64 data.
+ *   @dest: The destination, with room for '3 * len / 4' bytes.
+ *   @src: The source characters. The length must be a multiple of four.
+ *   @len: The number of characters.
+ *   &returns: The number of bytes written.
+ */
+
+_export
+size_t io_base64_dec(void *restrict dest, const char *restrict src, size_t len)
+{
+	size_t i, o, n;
+	uint32_t val;
+	int8_t digit;
+	uint8_t j, *ptr = dest;
+
+	if(len % 4 != 0)
+		throw("Invalid base64 length.");
+
+	i = _simd_base64_dec(ptr, src, len);
+
+	for(o = i / 4 * 3; i < len; i += 4) {
+		n = 3;
+		if(i + 4 == len) {
+			if(src[i + 3] == '=')
+				n--;
+
+			if((n == 2) && (src[i + 2] == '='))
+				n--;
+		}
+
+		val = 0;
+		for(j = 0; j < 4; j++) {
+			if(j > n)
+				digit = 0;
+			else if((digit = base64_val(src[i + j])) < 0)
+				throw("Invalid base64 data.");
+
+			val = (val << 6) | digit;
+		}
+
+		ptr[o++] = val >> 16;
+		if(n >= 2)
+			ptr[o++] = val >> 8;
+		if(n >= 3)
+			ptr[o++] = val;
+	}
+
+	return o;
+}
+
+/**
+ * Retrieve the value of a base64 digit.
+ *   @ch: The character.
+ *   &returns: The value or '-1' if invalid.
+ */
+
+static int8_t base64_val(char ch)
+{
+	if((ch >= 'A') && (ch <= 'Z'))
+		return ch - 'A';
+	else if((ch >= 'a') && (ch <= 'z'))
+		return ch - 'a' + 26;
+	else if((ch >= '0') && (ch <= '9'))
+		return ch - '0' + 52;
+	else if(ch == '+')
+		return 62;
+	else if(ch == '/')
+		return 63;
+	else
+		return -1;
+}
+
+
+#if defined(__x86_64__)
+/**
+ * Encode hexadecimal using SSSE3, sixteen bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes processed.
+ */
+
+__attribute__((target("ssse3")))
+size_t _hex_enc_ssse3(char *restrict dest, const uint8_t *restrict src, size_t nbytes)
+{
+	size_t i;
+	__m128i in, hi, lo;
+	const __m128i lut = _mm_loadu_si128((const __m128i *)hex_digits);
+	const __m128i mask = _mm_set1_epi8(0x0F);
+
+	for(i = 0; i + 16 <= nbytes; i += 16) {
+		in = _mm_loadu_si128((const __m128i *)(src + i));
+		hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(in, 4), mask));
+		lo = _mm_shuffle_epi8(lut, _mm_and_si128(in, mask));
+
+		_mm_storeu_si128((__m128i *)(dest + 2 * i), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i *)(dest + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+
+	return i;
+}
+
+/**
+ * Encode hexadecimal using AVX2, sixteen bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes processed.
+ */
+
+__attribute__((target("avx2")))
+size_t _hex_enc_avx2(char *restrict dest, const uint8_t *restrict src, size_t nbytes)
+{
+	size_t i;
+	__m256i in, idx;
+	const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hex_digits));
+	const __m256i mask = _mm256_set1_epi16(0x0F0F);
+
+	for(i = 0; i + 16 <= nbytes; i += 16) {
+		in = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + i)));
+		idx = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi16(in, 4), _mm256_slli_epi16(in, 8)), mask);
+
+		_mm256_storeu_si256((__m256i *)(dest + 2 * i), _mm256_shuffle_epi8(lut, idx));
+	}
+
+	return i;
+}
+
+
+/**
+ * Map six-bit values to base64 digits.
+ *   @idx: The six-bit values.
+ *   &returns: The digits.
+ */
+
+__attribute__((target("ssse3")))
+static inline __m128i base64_lookup_ssse3(__m128i idx)
+{
+	__m128i res;
+	const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+	res = _mm_or_si128(res, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+
+	return _mm_add_epi8(_mm_shuffle_epi8(shift, res), idx);
+}
+
+/**
+ * Encode base64 using SSSE3, twelve bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes processed.
+ */
+
+__attribute__((target("ssse3")))
+size_t _base64_enc_ssse3(char *restrict dest, const uint8_t *restrict src, size_t nbytes)
+{
+	size_t i, o;
+	__m128i in, idx;
+
+	for(i = o = 0; i + 16 <= nbytes; i += 12, o += 16) {
+		in = _mm_loadu_si128((const __m128i *)(src + i));
+		in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+		idx = _mm_or_si128(
+			_mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040)),
+			_mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010)));
+
+		_mm_storeu_si128((__m128i *)(dest + o), base64_lookup_ssse3(idx));
+	}
+
+	return i;
+}
+
+/**
+ * Encode base64 using AVX2, twenty-four bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes processed.
+ */
+
+__attribute__((target("avx2")))
+size_t _base64_enc_avx2(char *restrict dest, const uint8_t *restrict src, size_t nbytes)
+{
+	size_t i, o;
+	__m256i in, idx, res;
+	const __m256i shift = _mm256_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	for(i = o = 0; i + 28 <= nbytes; i += 24, o += 32) {
+		in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + i))), _mm_loadu_si128((const __m128i *)(src + i + 12)), 1);
+		in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+		idx = _mm256_or_si256(
+			_mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040)),
+			_mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010)));
+
+		res = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+		res = _mm256_or_si256(res, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+		res = _mm256_add_epi8(_mm256_shuffle_epi8(shift, res), idx);
+
+		_mm256_storeu_si256((__m256i *)(dest + o), res);
+	}
+
+	return i;
+}
+
+
+/**
+ * Decode base64 using SSSE3, sixteen characters at a time. Decoding stops at
+ * the first block containing padding or invalid characters, leaving it for
+ * the scalar decoder.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @len: The number of characters.
+ *   &returns: The number of characters processed.
+ */
+
+__attribute__((target("ssse3")))
+size_t _base64_dec_ssse3(uint8_t *restrict dest, const char *restrict src, size_t len)
+{
+	size_t i, o;
+	__m128i in, hi, lo, roll;
+	const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i mask = _mm_set1_epi8(0x0F);
+
+	for(i = o = 0; i + 24 <= len; i += 16, o += 12) {
+		in = _mm_loadu_si128((const __m128i *)(src + i));
+		hi = _mm_and_si128(_mm_srli_epi32(in, 4), mask);
+		lo = _mm_and_si128(in, mask);
+
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi)), _mm_setzero_si128())) != 0xFFFF)
+			break;
+
+		roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hi));
+		in = _mm_add_epi8(in, roll);
+
+		in = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+		in = _mm_madd_epi16(in, _mm_set1_epi32(0x00011000));
+		in = _mm_shuffle_epi8(in, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+		_mm_storeu_si128((__m128i *)(dest + o), in);
+	}
+
+	return i;
+}
+
+/**
+ * Decode base64 using AVX2, thirty-two characters at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @len: The number of characters.
+ *   &returns: The number of characters processed.
+ */
+
+__attribute__((target("avx2")))
+size_t _base64_dec_avx2(uint8_t *restrict dest, const char *restrict src, size_t len)
+{
+	size_t i, o;
+	__m256i in, hi, lo, roll;
+	const __m256i lut_lo = _mm256_broadcastsi128_si256(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A));
+	const __m256i lut_hi = _mm256_broadcastsi128_si256(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+	const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+	const __m256i mask = _mm256_set1_epi8(0x0F);
+	const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+	for(i = o = 0; i + 48 <= len; i += 32, o += 24) {
+		in = _mm256_loadu_si256((const __m256i *)(src + i));
+		hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask);
+		lo = _mm256_and_si256(in, mask);
+
+		if(!_mm256_testz_si256(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, hi)))
+			break;
+
+		roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')), hi));
+		in = _mm256_add_epi8(in, roll);
+
+		in = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+		in = _mm256_madd_epi16(in, _mm256_set1_epi32(0x00011000));
+		in = _mm256_shuffle_epi8(in, _mm256_broadcastsi128_si256(pack));
+		in = _mm256_permutevar8x32_epi32(in, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+
+		_mm256_storeu_si256((__m256i *)(dest + o), in);
+	}
+
+	return i;
+}
+#endif
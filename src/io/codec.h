@@ -0,0 +1,21 @@
+#ifndef IO_CODEC_H
+#define IO_CODEC_H
+
+/*
+ * codec size macros
+ */
+
+#define IO_HEX_LEN(nbytes) (2 * (nbytes))
+#define IO_BASE64_LEN(nbytes) (4 * (((nbytes) + 2) / 3))
+
+/*
+ * codec function declarations
+ */
+
+size_t io_hex_enc(char *restrict dest, const void *restrict src, size_t nbytes);
+size_t io_hex_dec(void *restrict dest, const char *restrict src, size_t len);
+
+size_t io_base64_enc(char *restrict dest, const void *restrict src, size_t nbytes);
+size_t io_base64_dec(void *restrict dest, const char *restrict src, size_t len);
+
+#endif
@@ -272,7 +272,7 @@ void io_printf_hex(struct io_output_t output, struct io_print_mod_t *mod, struct
 _export
 void io_printf_ptr(struct io_output_t output, struct io_print_mod_t *mod, struct arglist_t *list)
 {
-	io_format_uint(output, (unsigned int)(intptr_t)va_arg(list->args, void *), 16, 2*sizeof(void *), mod->neg, '0');
+	io_format_uint64(output, (uintptr_t)va_arg(list->args, void *), 16, 2*sizeof(void *), mod->neg, '0');
 }
 
 /**
@@ -385,9 +385,25 @@ void io_format_int(struct io_output_t output, int value, uint8_t base, int16_t w
 
 _export
 void io_format_uint(struct io_output_t output, unsigned int value, uint8_t base, int16_t width, bool neg, char pad)
+{
+	io_format_uint64(output, value, base, width, neg, pad);
+}
+
+/**
+ * Format a 64-bit unsigned integer.
+ *   @output: The output device.
+ *   @value: The value.
+ *   @base: The base.
+ *   @width: The width.
+ *   @neg: Negative alignment.
+ *   @pad: Padding character.
+ */
+
+_export
+void io_format_uint64(struct io_output_t output, uint64_t value, uint8_t base, int16_t width, bool neg, char pad)
 {
 	uint8_t i = 0;
-	uint16_t len = m_max_uint16(width, 19);
+	uint16_t len = m_max_uint16(width, 64);
 	char buf[len];
 
 	do {
@@ -0,0 +1,667 @@
+#include "../common.h"
+#include "serial.h"
+#include "../mem.h"
+#include "../string.h"
+#include "../try.h"
+#include "input.h"
+#include "output.h"
+
+#if defined(__x86_64__)
+#	include <immintrin.h>
+#endif
+
+
+/*
+ * host byte order definitions
+ */
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#	define HOST_LE 1
+#else
+#	define HOST_LE 0
+#endif
+
+/**
+ * Byte swap callback.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ */
+
+typedef void (*bswap_f)(void *dest, const void *src, size_t cnt);
+
+/*
+ * decoder definitions
+ */
+
+#define DEC_CHUNK	65536
+
+
+/*
+ * local function declarations
+ */
+
+static void enc_arr(struct io_enc_t *enc, const void *arr, size_t cnt, size_t size, bswap_f swap);
+static void dec_arr(struct io_dec_t *dec, void *arr, size_t cnt, size_t size, bswap_f swap);
+static uint8_t *dec_len(struct io_dec_t *dec, uint64_t len, size_t extra);
+
+#if defined(__x86_64__)
+static void bswap_ssse3(void *dest, const void *src, size_t nbytes, __m128i mask);
+#endif
+
+
+/**
+ * Byte swap an array of 16-bit values. The source and destination may be
+ * the same.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_bswap16(void *dest, const void *src, size_t cnt)
+{
+	size_t i;
+	uint16_t val;
+
+	i = _simd_bswap16(dest, src, cnt);
+
+	for(; i < cnt; i++) {
+		memcpy(&val, src + 2 * i, 2);
+		val = __builtin_bswap16(val);
+		memcpy(dest + 2 * i, &val, 2);
+	}
+}
+
+/**
+ * Byte swap an array of 32-bit values. The source and destination may be
+ * the same.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_bswap32(void *dest, const void *src, size_t cnt)
+{
+	size_t i;
+	uint32_t val;
+
+	i = _simd_bswap32(dest, src, cnt);
+
+	for(; i < cnt; i++) {
+		memcpy(&val, src + 4 * i, 4);
+		val = __builtin_bswap32(val);
+		memcpy(dest + 4 * i, &val, 4);
+	}
+}
+
+/**
+ * Byte swap an array of 64-bit values. The source and destination may be
+ * the same.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_bswap64(void *dest, const void *src, size_t cnt)
+{
+	size_t i;
+	uint64_t val;
+
+	i = _simd_bswap64(dest, src, cnt);
+
+	for(; i < cnt; i++) {
+		memcpy(&val, src + 8 * i, 8);
+		val = __builtin_bswap64(val);
+		memcpy(dest + 8 * i, &val, 8);
+	}
+}
+
+#if defined(__x86_64__)
+/**
+ * Byte swap using a SSSE3 shuffle.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes, a multiple of sixteen.
+ *   @mask: The shuffle mask.
+ */
+
+__attribute__((target("ssse3")))
+static void bswap_ssse3(void *dest, const void *src, size_t nbytes, __m128i mask)
+{
+	size_t i;
+
+	for(i = 0; i < nbytes; i += 16)
+		_mm_storeu_si128(dest + i, _mm_shuffle_epi8(_mm_loadu_si128(src + i), mask));
+}
+
+/**
+ * Byte swap an array of 16-bit values using SSSE3, sixteen bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ *   &returns: The number of elements processed.
+ */
+
+__attribute__((target("ssse3")))
+size_t _bswap16_ssse3(void *dest, const void *src, size_t cnt)
+{
+	size_t i = cnt & ~(size_t)7;
+
+	bswap_ssse3(dest, src, 2 * i, _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1));
+
+	return i;
+}
+
+/**
+ * Byte swap an array of 32-bit values using SSSE3, sixteen bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ *   &returns: The number of elements processed.
+ */
+
+__attribute__((target("ssse3")))
+size_t _bswap32_ssse3(void *dest, const void *src, size_t cnt)
+{
+	size_t i = cnt & ~(size_t)3;
+
+	bswap_ssse3(dest, src, 4 * i, _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+
+	return i;
+}
+
+/**
+ * Byte swap an array of 64-bit values using SSSE3, sixteen bytes at a time.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ *   &returns: The number of elements processed.
+ */
+
+__attribute__((target("ssse3")))
+size_t _bswap64_ssse3(void *dest, const void *src, size_t cnt)
+{
+	size_t i = cnt & ~(size_t)1;
+
+	bswap_ssse3(dest, src, 8 * i, _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7));
+
+	return i;
+}
+#endif
+
+
+/**
+ * Initialize an encoder.
+ *   @enc: The encoder.
+ *   @output: The output.
+ */
+
+_export
+void io_enc_init(struct io_enc_t *enc, struct io_output_t output)
+{
+	enc->output = output;
+	enc->i = 0;
+}
+
+/**
+ * Flush all buffered data to the output.
+ *   @enc: The encoder.
+ */
+
+_export
+void io_enc_flush(struct io_enc_t *enc)
+{
+	_io_enc_drain(enc);
+}
+
+/**
+ * Drain the encoder buffer to the output.
+ *   @enc: The encoder.
+ */
+
+_export
+void _io_enc_drain(struct io_enc_t *enc)
+{
+	io_output_full(enc->output, enc->buf, enc->i);
+	enc->i = 0;
+}
+
+
+/**
+ * Encode raw bytes.
+ *   @enc: The encoder.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+_export
+void io_enc_bytes(struct io_enc_t *enc, const void *restrict buf, size_t nbytes)
+{
+	if(enc->i + nbytes > IO_SERIAL_BUFSIZE) {
+		_io_enc_drain(enc);
+
+		if(nbytes >= IO_SERIAL_BUFSIZE) {
+			io_output_full(enc->output, buf, nbytes);
+			return;
+		}
+	}
+
+	memcpy(enc->buf + enc->i, buf, nbytes);
+	enc->i += nbytes;
+}
+
+/**
+ * Encode a length-prefixed blob.
+ *   @enc: The encoder.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+_export
+void io_enc_blob(struct io_enc_t *enc, const void *restrict buf, size_t nbytes)
+{
+	io_enc_varint(enc, nbytes);
+	io_enc_bytes(enc, buf, nbytes);
+}
+
+/**
+ * Encode a length-prefixed string.
+ *   @enc: The encoder.
+ *   @str: The string.
+ */
+
+_export
+void io_enc_str(struct io_enc_t *enc, const char *restrict str)
+{
+	io_enc_blob(enc, str, str_len(str));
+}
+
+
+/**
+ * Encode an array of little-endian 16-bit integers.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_enc_arr16le(struct io_enc_t *enc, const uint16_t *restrict arr, size_t cnt)
+{
+	enc_arr(enc, arr, cnt, 2, HOST_LE ? NULL : io_bswap16);
+}
+
+/**
+ * Encode an array of big-endian 16-bit integers.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_enc_arr16be(struct io_enc_t *enc, const uint16_t *restrict arr, size_t cnt)
+{
+	enc_arr(enc, arr, cnt, 2, HOST_LE ? io_bswap16 : NULL);
+}
+
+/**
+ * Encode an array of little-endian 32-bit integers.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_enc_arr32le(struct io_enc_t *enc, const uint32_t *restrict arr, size_t cnt)
+{
+	enc_arr(enc, arr, cnt, 4, HOST_LE ? NULL : io_bswap32);
+}
+
+/**
+ * Encode an array of big-endian 32-bit integers.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_enc_arr32be(struct io_enc_t *enc, const uint32_t *restrict arr, size_t cnt)
+{
+	enc_arr(enc, arr, cnt, 4, HOST_LE ? io_bswap32 : NULL);
+}
+
+/**
+ * Encode an array of little-endian 64-bit integers.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_enc_arr64le(struct io_enc_t *enc, const uint64_t *restrict arr, size_t cnt)
+{
+	enc_arr(enc, arr, cnt, 8, HOST_LE ? NULL : io_bswap64);
+}
+
+/**
+ * Encode an array of big-endian 64-bit integers.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_enc_arr64be(struct io_enc_t *enc, const uint64_t *restrict arr, size_t cnt)
+{
+	enc_arr(enc, arr, cnt, 8, HOST_LE ? io_bswap64 : NULL);
+}
+
+/**
+ * Encode an array, swapping each element into the buffer if needed.
+ *   @enc: The encoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ *   @size: The element size.
+ *   @swap: Optional. The byte swap function.
+ */
+
+static void enc_arr(struct io_enc_t *enc, const void *arr, size_t cnt, size_t size, bswap_f swap)
+{
+	size_t n;
+
+	if(swap == NULL) {
+		io_enc_bytes(enc, arr, cnt * size);
+		return;
+	}
+
+	while(cnt > 0) {
+		n = (IO_SERIAL_BUFSIZE - enc->i) / size;
+		if(n == 0) {
+			_io_enc_drain(enc);
+			continue;
+		}
+
+		if(n > cnt)
+			n = cnt;
+
+		swap(enc->buf + enc->i, arr, n);
+		enc->i += n * size;
+		arr += n * size;
+		cnt -= n;
+	}
+}
+
+
+/**
+ * Initialize a decoder.
+ *   @dec: The decoder.
+ *   @input: The input.
+ */
+
+_export
+void io_dec_init(struct io_dec_t *dec, struct io_input_t input)
+{
+	dec->input = input;
+	dec->i = dec->n = 0;
+}
+
+/**
+ * Fill the decoder buffer until a number of bytes are available.
+ *   @dec: The decoder.
+ *   @nbytes: The number of bytes.
+ */
+
+_export
+void _io_dec_fill(struct io_dec_t *dec, size_t nbytes)
+{
+	size_t rd;
+
+	memmove(dec->buf, dec->buf + dec->i, dec->n - dec->i);
+	dec->n -= dec->i;
+	dec->i = 0;
+
+	while(dec->n < nbytes) {
+		rd = io_input_read(dec->input, dec->buf + dec->n, IO_SERIAL_BUFSIZE - dec->n);
+		if(rd == 0)
+			throw("Unable to read data from input.");
+
+		dec->n += rd;
+	}
+}
+
+
+/**
+ * Decode raw bytes.
+ *   @dec: The decoder.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+_export
+void io_dec_bytes(struct io_dec_t *dec, void *restrict buf, size_t nbytes)
+{
+	size_t avail;
+
+	avail = dec->n - dec->i;
+	if(nbytes > avail) {
+		memcpy(buf, dec->buf + dec->i, avail);
+		dec->i = dec->n = 0;
+		buf += avail;
+		nbytes -= avail;
+
+		if(nbytes >= IO_SERIAL_BUFSIZE) {
+			io_input_full(dec->input, buf, nbytes);
+			return;
+		}
+
+		_io_dec_fill(dec, nbytes);
+	}
+
+	memcpy(buf, dec->buf + dec->i, nbytes);
+	dec->i += nbytes;
+}
+
+/**
+ * Decode an unsigned LEB128 varint. Encodings that overflow 64 bits are
+ * rejected.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+_export
+uint64_t io_dec_varint(struct io_dec_t *dec)
+{
+	uint8_t byte;
+	unsigned int shift;
+	uint64_t val = 0;
+
+	for(shift = 0; shift < 64; shift += 7) {
+		byte = io_dec_u8(dec);
+		if((shift == 63) && (byte > 1))
+			throw("Invalid varint.");
+
+		val |= (uint64_t)(byte & 0x7F) << shift;
+
+		if(!(byte & 0x80))
+			return val;
+	}
+
+	throw("Invalid varint.");
+}
+
+/**
+ * Decode a length-prefixed blob. The blob is allocated as its payload is
+ * read, so a corrupt length cannot force a large allocation up front.
+ *   @dec: The decoder.
+ *   @nbytes: Optional. The number of bytes.
+ *   &returns: The allocated blob.
+ */
+
+_export
+void *io_dec_blob(struct io_dec_t *dec, size_t *nbytes)
+{
+	void *buf;
+	uint64_t len;
+
+	len = io_dec_varint(dec);
+	if(len > SIZE_MAX / 2)
+		throw("Invalid blob length.");
+
+	buf = dec_len(dec, len, 0);
+
+	if(nbytes != NULL)
+		*nbytes = len;
+
+	return buf;
+}
+
+/**
+ * Decode a length-prefixed string, allocated as it is read.
+ *   @dec: The decoder.
+ *   &returns: The allocated string.
+ */
+
+_export
+char *io_dec_str(struct io_dec_t *dec)
+{
+	char *str;
+	uint64_t len;
+
+	len = io_dec_varint(dec);
+	if(len > SIZE_MAX / 2)
+		throw("Invalid string length.");
+
+	str = (char *)dec_len(dec, len, 1);
+	str[len] = '\0';
+
+	return str;
+}
+
+
+/**
+ * Decode an array of little-endian 16-bit integers.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_dec_arr16le(struct io_dec_t *dec, uint16_t *restrict arr, size_t cnt)
+{
+	dec_arr(dec, arr, cnt, 2, HOST_LE ? NULL : io_bswap16);
+}
+
+/**
+ * Decode an array of big-endian 16-bit integers.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_dec_arr16be(struct io_dec_t *dec, uint16_t *restrict arr, size_t cnt)
+{
+	dec_arr(dec, arr, cnt, 2, HOST_LE ? io_bswap16 : NULL);
+}
+
+/**
+ * Decode an array of little-endian 32-bit integers.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_dec_arr32le(struct io_dec_t *dec, uint32_t *restrict arr, size_t cnt)
+{
+	dec_arr(dec, arr, cnt, 4, HOST_LE ? NULL : io_bswap32);
+}
+
+/**
+ * Decode an array of big-endian 32-bit integers.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_dec_arr32be(struct io_dec_t *dec, uint32_t *restrict arr, size_t cnt)
+{
+	dec_arr(dec, arr, cnt, 4, HOST_LE ? io_bswap32 : NULL);
+}
+
+/**
+ * Decode an array of little-endian 64-bit integers.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_dec_arr64le(struct io_dec_t *dec, uint64_t *restrict arr, size_t cnt)
+{
+	dec_arr(dec, arr, cnt, 8, HOST_LE ? NULL : io_bswap64);
+}
+
+/**
+ * Decode an array of big-endian 64-bit integers.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ */
+
+_export
+void io_dec_arr64be(struct io_dec_t *dec, uint64_t *restrict arr, size_t cnt)
+{
+	dec_arr(dec, arr, cnt, 8, HOST_LE ? io_bswap64 : NULL);
+}
+
+/**
+ * Decode an array, swapping the elements in place if needed.
+ *   @dec: The decoder.
+ *   @arr: The array.
+ *   @cnt: The number of elements.
+ *   @size: The element size.
+ *   @swap: Optional. The byte swap function.
+ */
+
+static void dec_arr(struct io_dec_t *dec, void *arr, size_t cnt, size_t size, bswap_f swap)
+{
+	io_dec_bytes(dec, arr, cnt * size);
+
+	if(swap != NULL)
+		swap(arr, arr, cnt);
+}
+
+/**
+ * Decode a payload of a given length, growing the allocation as the bytes
+ * arrive.
+ *   @dec: The decoder.
+ *   @len: The payload length.
+ *   @extra: The number of extra bytes allocated past the payload.
+ *   &returns: The allocated payload.
+ */
+
+static uint8_t *dec_len(struct io_dec_t *dec, uint64_t len, size_t extra)
+{
+	uint8_t *buf;
+	size_t have = 0, cap;
+
+	cap = (len < DEC_CHUNK) ? len : DEC_CHUNK;
+	buf = mem_alloc(cap + extra);
+
+	while(true) {
+		io_dec_bytes(dec, buf + have, cap - have);
+		have = cap;
+
+		if(have == len)
+			break;
+
+		cap = (len - cap < cap) ? len : (cap * 2);
+		buf = mem_realloc(buf, cap + extra);
+	}
+
+	return buf;
+}
@@ -0,0 +1,408 @@
+#ifndef IO_SERIAL_H
+#define IO_SERIAL_H
+
+/*
+ * serializer definitions
+ */
+
+#define IO_SERIAL_BUFSIZE	4096
+
+/**
+ * Encoder structure. Values are encoded into the buffer and written to the
+ * output in bulk when the buffer fills or is flushed.
+ *   @output: The output.
+ *   @i: The buffer index.
+ *   @buf: The buffer.
+ */
+
+struct io_enc_t {
+	struct io_output_t output;
+
+	size_t i;
+	uint8_t buf[IO_SERIAL_BUFSIZE];
+};
+
+/**
+ * Decoder structure. The decoder reads ahead from the input, so the input
+ * should not be read directly while the decoder is in use.
+ *   @input: The input.
+ *   @i, n: The buffer index and number of buffered bytes.
+ *   @buf: The buffer.
+ */
+
+struct io_dec_t {
+	struct io_input_t input;
+
+	size_t i, n;
+	uint8_t buf[IO_SERIAL_BUFSIZE];
+};
+
+
+/*
+ * byte swap function declarations
+ */
+
+void io_bswap16(void *dest, const void *src, size_t cnt);
+void io_bswap32(void *dest, const void *src, size_t cnt);
+void io_bswap64(void *dest, const void *src, size_t cnt);
+
+/*
+ * encoder function declarations
+ */
+
+void io_enc_init(struct io_enc_t *enc, struct io_output_t output);
+void io_enc_flush(struct io_enc_t *enc);
+void _io_enc_drain(struct io_enc_t *enc);
+
+void io_enc_bytes(struct io_enc_t *enc, const void *restrict buf, size_t nbytes);
+void io_enc_blob(struct io_enc_t *enc, const void *restrict buf, size_t nbytes);
+void io_enc_str(struct io_enc_t *enc, const char *restrict str);
+
+void io_enc_arr16le(struct io_enc_t *enc, const uint16_t *restrict arr, size_t cnt);
+void io_enc_arr16be(struct io_enc_t *enc, const uint16_t *restrict arr, size_t cnt);
+void io_enc_arr32le(struct io_enc_t *enc, const uint32_t *restrict arr, size_t cnt);
+void io_enc_arr32be(struct io_enc_t *enc, const uint32_t *restrict arr, size_t cnt);
+void io_enc_arr64le(struct io_enc_t *enc, const uint64_t *restrict arr, size_t cnt);
+void io_enc_arr64be(struct io_enc_t *enc, const uint64_t *restrict arr, size_t cnt);
+
+/*
+ * decoder function declarations
+ */
+
+void io_dec_init(struct io_dec_t *dec, struct io_input_t input);
+void _io_dec_fill(struct io_dec_t *dec, size_t nbytes);
+
+void io_dec_bytes(struct io_dec_t *dec, void *restrict buf, size_t nbytes);
+uint64_t io_dec_varint(struct io_dec_t *dec);
+void *io_dec_blob(struct io_dec_t *dec, size_t *nbytes);
+char *io_dec_str(struct io_dec_t *dec);
+
+void io_dec_arr16le(struct io_dec_t *dec, uint16_t *restrict arr, size_t cnt);
+void io_dec_arr16be(struct io_dec_t *dec, uint16_t *restrict arr, size_t cnt);
+void io_dec_arr32le(struct io_dec_t *dec, uint32_t *restrict arr, size_t cnt);
+void io_dec_arr32be(struct io_dec_t *dec, uint32_t *restrict arr, size_t cnt);
+void io_dec_arr64le(struct io_dec_t *dec, uint64_t *restrict arr, size_t cnt);
+void io_dec_arr64be(struct io_dec_t *dec, uint64_t *restrict arr, size_t cnt);
+
+
+/**
+ * Zigzag encode a signed integer so that small magnitudes have small
+ * encodings.
+ *   @val: The signed value.
+ *   &returns: The encoded value.
+ */
+
+static inline uint64_t io_zigzag(int64_t val)
+{
+	return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+/**
+ * Decode a zigzag encoded integer.
+ *   @val: The encoded value.
+ *   &returns: The signed value.
+ */
+
+static inline int64_t io_unzigzag(uint64_t val)
+{
+	return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+/**
+ * Encode an LEB128 varint into memory.
+ *   @buf: The buffer, with room for at least ten bytes.
+ *   @val: The value.
+ *   &returns: The number of bytes used.
+ */
+
+static inline size_t io_varint_put(uint8_t *buf, uint64_t val)
+{
+	size_t n = 0;
+
+	while(val >= 0x80) {
+		buf[n++] = (uint8_t)val | 0x80;
+		val >>= 7;
+	}
+
+	buf[n++] = (uint8_t)val;
+
+	return n;
+}
+
+
+/**
+ * Reserve space in the encoder buffer.
+ *   @enc: The encoder.
+ *   @nbytes: The number of bytes, at most 'IO_SERIAL_BUFSIZE'.
+ *   &returns: The pointer to the reserved space.
+ */
+
+static inline uint8_t *io_enc_reserve(struct io_enc_t *enc, size_t nbytes)
+{
+	uint8_t *ptr;
+
+	if(enc->i + nbytes > IO_SERIAL_BUFSIZE)
+		_io_enc_drain(enc);
+
+	ptr = enc->buf + enc->i;
+	enc->i += nbytes;
+
+	return ptr;
+}
+
+/**
+ * Encode a byte.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u8(struct io_enc_t *enc, uint8_t val)
+{
+	io_enc_reserve(enc, 1)[0] = val;
+}
+
+/**
+ * Encode a little-endian 16-bit integer.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u16le(struct io_enc_t *enc, uint16_t val)
+{
+	uint8_t *ptr = io_enc_reserve(enc, 2);
+
+	ptr[0] = val;
+	ptr[1] = val >> 8;
+}
+
+/**
+ * Encode a big-endian 16-bit integer.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u16be(struct io_enc_t *enc, uint16_t val)
+{
+	uint8_t *ptr = io_enc_reserve(enc, 2);
+
+	ptr[0] = val >> 8;
+	ptr[1] = val;
+}
+
+/**
+ * Encode a little-endian 32-bit integer.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u32le(struct io_enc_t *enc, uint32_t val)
+{
+	uint8_t *ptr = io_enc_reserve(enc, 4);
+
+	ptr[0] = val;
+	ptr[1] = val >> 8;
+	ptr[2] = val >> 16;
+	ptr[3] = val >> 24;
+}
+
+/**
+ * Encode a big-endian 32-bit integer.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u32be(struct io_enc_t *enc, uint32_t val)
+{
+	uint8_t *ptr = io_enc_reserve(enc, 4);
+
+	ptr[0] = val >> 24;
+	ptr[1] = val >> 16;
+	ptr[2] = val >> 8;
+	ptr[3] = val;
+}
+
+/**
+ * Encode a little-endian 64-bit integer.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u64le(struct io_enc_t *enc, uint64_t val)
+{
+	uint8_t i, *ptr = io_enc_reserve(enc, 8);
+
+	for(i = 0; i < 8; i++)
+		ptr[i] = val >> (8 * i);
+}
+
+/**
+ * Encode a big-endian 64-bit integer.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_u64be(struct io_enc_t *enc, uint64_t val)
+{
+	uint8_t i, *ptr = io_enc_reserve(enc, 8);
+
+	for(i = 0; i < 8; i++)
+		ptr[i] = val >> (56 - 8 * i);
+}
+
+/**
+ * Encode an unsigned LEB128 varint.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_varint(struct io_enc_t *enc, uint64_t val)
+{
+	if(enc->i + 10 > IO_SERIAL_BUFSIZE)
+		_io_enc_drain(enc);
+
+	enc->i += io_varint_put(enc->buf + enc->i, val);
+}
+
+/**
+ * Encode a signed zigzag LEB128 varint.
+ *   @enc: The encoder.
+ *   @val: The value.
+ */
+
+static inline void io_enc_svarint(struct io_enc_t *enc, int64_t val)
+{
+	io_enc_varint(enc, io_zigzag(val));
+}
+
+
+/**
+ * Consume bytes from the decoder buffer.
+ *   @dec: The decoder.
+ *   @nbytes: The number of bytes, at most 'IO_SERIAL_BUFSIZE'.
+ *   &returns: The pointer to the consumed bytes.
+ */
+
+static inline const uint8_t *io_dec_take(struct io_dec_t *dec, size_t nbytes)
+{
+	const uint8_t *ptr;
+
+	if(dec->i + nbytes > dec->n)
+		_io_dec_fill(dec, nbytes);
+
+	ptr = dec->buf + dec->i;
+	dec->i += nbytes;
+
+	return ptr;
+}
+
+/**
+ * Decode a byte.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint8_t io_dec_u8(struct io_dec_t *dec)
+{
+	return io_dec_take(dec, 1)[0];
+}
+
+/**
+ * Decode a little-endian 16-bit integer.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint16_t io_dec_u16le(struct io_dec_t *dec)
+{
+	const uint8_t *ptr = io_dec_take(dec, 2);
+
+	return (uint16_t)ptr[0] | ((uint16_t)ptr[1] << 8);
+}
+
+/**
+ * Decode a big-endian 16-bit integer.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint16_t io_dec_u16be(struct io_dec_t *dec)
+{
+	const uint8_t *ptr = io_dec_take(dec, 2);
+
+	return ((uint16_t)ptr[0] << 8) | (uint16_t)ptr[1];
+}
+
+/**
+ * Decode a little-endian 32-bit integer.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint32_t io_dec_u32le(struct io_dec_t *dec)
+{
+	const uint8_t *ptr = io_dec_take(dec, 4);
+
+	return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+/**
+ * Decode a big-endian 32-bit integer.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint32_t io_dec_u32be(struct io_dec_t *dec)
+{
+	const uint8_t *ptr = io_dec_take(dec, 4);
+
+	return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) | ((uint32_t)ptr[2] << 8) | (uint32_t)ptr[3];
+}
+
+/**
+ * Decode a little-endian 64-bit integer.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint64_t io_dec_u64le(struct io_dec_t *dec)
+{
+	uint8_t i;
+	uint64_t val = 0;
+	const uint8_t *ptr = io_dec_take(dec, 8);
+
+	for(i = 0; i < 8; i++)
+		val |= (uint64_t)ptr[i] << (8 * i);
+
+	return val;
+}
+
+/**
+ * Decode a big-endian 64-bit integer.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline uint64_t io_dec_u64be(struct io_dec_t *dec)
+{
+	uint8_t i;
+	uint64_t val = 0;
+	const uint8_t *ptr = io_dec_take(dec, 8);
+
+	for(i = 0; i < 8; i++)
+		val = (val << 8) | ptr[i];
+
+	return val;
+}
+
+/**
+ * Decode a signed zigzag LEB128 varint.
+ *   @dec: The decoder.
+ *   &returns: The value.
+ */
+
+static inline int64_t io_dec_svarint(struct io_dec_t *dec)
+{
+	return io_unzigzag(io_dec_varint(dec));
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include "../common.h"
 #include "wrap.h"
 #include "../mem.h"
+#include "../try.h"
+#include "codec.h"
+#include "device.h"
 #include "input.h"
+#include "output.h"
 
 
 union io_u {
@@ -22,6 +26,38 @@ struct cursor_t {
 	uint32_t *line, *col;
 };
 
+/**
+ * Base64 encoder structure.
+ *   @output: The underlying output.
+ *   @n: The number of pending bytes.
+ *   @rem: The pending bytes.
+ */
+
+struct b64enc_t {
+	struct io_output_t output;
+
+	uint8_t n, rem[3];
+};
+
+/**
+ * Base64 decoder structure.
+ *   @input: The underlying input.
+ *   @eof: The end-of-file flag.
+ *   @i, n: The index and number of decoded bytes.
+ *   @len: The number of pending characters.
+ *   @out: The decoded bytes.
+ *   @in: The pending characters.
+ */
+
+struct b64dec_t {
+	struct io_input_t input;
+
+	bool eof;
+	size_t i, n, len;
+	uint8_t out[768];
+	char in[1024];
+};
+
 
 /*
  * local function declarations
@@ -30,6 +66,12 @@ struct cursor_t {
 static inline bool cursor_ctrl(void *ref, unsigned int cmd, void *data);
 static inline size_t cursor_read(void *ref, void *restrict buf, size_t nbytes);
 
+static size_t b64enc_write(void *ref, const void *restrict buf, size_t nbytes);
+static void b64enc_close(void *ref);
+
+static size_t b64dec_read(void *ref, void *restrict buf, size_t nbytes);
+static void b64dec_fill(struct b64dec_t *dec);
+
 
 /**
  * Create an input cursor.
@@ -102,3 +144,161 @@ static inline size_t cursor_read(void *ref, void *restrict buf, size_t nbytes)
 
 	return nbytes;
 }
+
+
+/**
+ * Create a base64 encoding output. Closing the encoder writes any final
+ * padding but does not close the underlying output.
+ *   @output: The underlying output.
+ *   &returns: The output.
+ */
+
+_export
+struct io_output_t io_output_base64enc(struct io_output_t output)
+{
+	struct b64enc_t *enc;
+	static const struct io_output_i iface = { { io_null_ctrl, b64enc_close }, b64enc_write };
+
+	enc = mem_alloc(sizeof(struct b64enc_t));
+	enc->output = output;
+	enc->n = 0;
+
+	return (struct io_output_t){ enc, &iface };
+}
+
+/**
+ * Write data to a base64 encoder.
+ *   @ref: The reference.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes written.
+ */
+
+static size_t b64enc_write(void *ref, const void *restrict buf, size_t nbytes)
+{
+	size_t n;
+	char str[IO_BASE64_LEN(768)];
+	struct b64enc_t *enc = ref;
+	const uint8_t *ptr = buf, *end = ptr + nbytes;
+
+	if(enc->n > 0) {
+		while((enc->n < 3) && (ptr < end))
+			enc->rem[enc->n++] = *ptr++;
+
+		if(enc->n < 3)
+			return nbytes;
+
+		io_output_full(enc->output, str, io_base64_enc(str, enc->rem, 3));
+		enc->n = 0;
+	}
+
+	while((end - ptr) >= 3) {
+		n = ((end - ptr) < 768) ? ((end - ptr) / 3 * 3) : 768;
+		io_output_full(enc->output, str, io_base64_enc(str, ptr, n));
+		ptr += n;
+	}
+
+	while(ptr < end)
+		enc->rem[enc->n++] = *ptr++;
+
+	return nbytes;
+}
+
+/**
+ * Close a base64 encoder, writing the final padded quantum.
+ *   @ref: The reference.
+ */
+
+static void b64enc_close(void *ref)
+{
+	char str[4];
+	struct b64enc_t *enc = ref;
+
+	if(enc->n > 0)
+		io_output_full(enc->output, str, io_base64_enc(str, enc->rem, enc->n));
+
+	mem_free(enc);
+}
+
+
+/**
+ * Create a base64 decoding input. Whitespace between characters is ignored.
+ * Closing the decoder does not close the underlying input.
+ *   @input: The underlying input.
+ *   &returns: The input.
+ */
+
+_export
+struct io_input_t io_input_base64dec(struct io_input_t input)
+{
+	struct b64dec_t *dec;
+	static const struct io_input_i iface = { { io_null_ctrl, mem_free }, b64dec_read };
+
+	dec = mem_alloc(sizeof(struct b64dec_t));
+	dec->input = input;
+	dec->eof = false;
+	dec->i = dec->n = dec->len = 0;
+
+	return (struct io_input_t){ dec, &iface };
+}
+
+/**
+ * Read data from a base64 decoder.
+ *   @ref: The reference.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes read, zero at the end of the input.
+ */
+
+static size_t b64dec_read(void *ref, void *restrict buf, size_t nbytes)
+{
+	struct b64dec_t *dec = ref;
+
+	while(dec->i == dec->n) {
+		if(dec->eof)
+			return 0;
+
+		b64dec_fill(dec);
+	}
+
+	if(nbytes > (dec->n - dec->i))
+		nbytes = dec->n - dec->i;
+
+	mem_copy(buf, dec->out + dec->i, nbytes);
+	dec->i += nbytes;
+
+	return nbytes;
+}
+
+/**
+ * Read and decode the next block of characters.
+ *   @dec: The decoder.
+ */
+
+static void b64dec_fill(struct b64dec_t *dec)
+{
+	char ch;
+	size_t i, len, m;
+
+	len = io_input_read(dec->input, dec->in + dec->len, sizeof(dec->in) - dec->len);
+	if(len == 0) {
+		if(dec->len > 0)
+			throw("Invalid base64 length.");
+
+		dec->eof = true;
+		return;
+	}
+
+	for(i = dec->len, len += dec->len; i < len; i++) {
+		ch = dec->in[i];
+		if((ch != ' ') && (ch != '\t') && (ch != '\r') && (ch != '\n'))
+			dec->in[dec->len++] = ch;
+	}
+
+	m = dec->len / 4 * 4;
+	dec->n = io_base64_dec(dec->out, dec->in, m);
+	dec->i = 0;
+
+	mem_move(dec->in, dec->in + m, dec->len - m);
+	dec->len -= m;
+}
@@ -3,4 +3,7 @@
 
 struct io_input_t io_input_cursor(struct io_input_t input, uint32_t *line, uint32_t *col);
 
+struct io_output_t io_output_base64enc(struct io_output_t output);
+struct io_input_t io_input_base64dec(struct io_input_t input);
+
 #endif
@@ -0,0 +1,133 @@
+#include "common.h"
+#include "lockprof.h"
+#include "io/output.h"
+#include "io/print.h"
+#include "posix/inc.h"
+
+
+/*
+ * local function declarations
+ */
+
+#if _lockprof
+static int stat_cmp(const void *left, const void *right);
+static void print_time(struct io_output_t output, uint64_t ns);
+#endif
+
+
+/**
+ * Write the lock contention report, built with 'LOCKPROF' defined. Locks
+ * are sorted by total wait time, each listing its acquisitions, contended
+ * acquisitions, failed attempts, wait and hold times, and a histogram of
+ * contended waits in power-of-two nanosecond bins. Locks are identified by
+ * name or address; destroyed locks are merged by name.
+ *   @output: The output.
+ */
+
+_export
+void lockprof_write(struct io_output_t output)
+{
+#if _lockprof
+	unsigned int i, k, cnt;
+	struct _lockstat_t *list;
+
+	list = _lockstat_snapshot(&cnt);
+	qsort(list, cnt, sizeof(struct _lockstat_t), stat_cmp);
+
+	io_print_str(output, "lock profile: ");
+	io_format_uint64(output, cnt, 10, 0, false, ' ');
+	io_print_str(output, " locks\n");
+
+	for(i = 0; i < cnt; i++) {
+		if(list[i].acquires == 0)
+			continue;
+
+		if(list[i].name != NULL)
+			io_print_str(output, list[i].name);
+		else if(list[i].addr != NULL)
+			io_format_uint64(output, (uintptr_t)list[i].addr, 16, 2 * sizeof(void *), false, '0');
+		else
+			io_print_str(output, "(destroyed)");
+
+		io_print_str(output, "\n  acquires ");
+		io_format_uint64(output, list[i].acquires, 10, 0, false, ' ');
+		io_print_str(output, ", contended ");
+		io_format_uint64(output, list[i].contended, 10, 0, false, ' ');
+		io_print_str(output, ", failed ");
+		io_format_uint64(output, list[i].failed, 10, 0, false, ' ');
+
+		io_print_str(output, "\n  wait ");
+		print_time(output, list[i].wait);
+		io_print_str(output, " total, ");
+		print_time(output, list[i].contended ? (list[i].wait / list[i].contended) : 0);
+		io_print_str(output, " mean, ");
+		print_time(output, list[i].maxwait);
+		io_print_str(output, " max");
+
+		io_print_str(output, "\n  hold ");
+		print_time(output, list[i].hold);
+		io_print_str(output, " total, ");
+		print_time(output, list[i].hold / list[i].acquires);
+		io_print_str(output, " mean, ");
+		print_time(output, list[i].maxhold);
+		io_print_str(output, " max\n");
+
+		for(k = 0; k < LOCKPROF_BINS; k++) {
+			if(list[i].hist[k] == 0)
+				continue;
+
+			io_print_str(output, "    < ");
+			print_time(output, (uint64_t)1 << k);
+			io_print_str(output, ": ");
+			io_format_uint64(output, list[i].hist[k], 10, 0, false, ' ');
+			io_print_char(output, '\n');
+		}
+	}
+
+	free(list);
+#else
+	io_print_str(output, "lock profile: disabled\n");
+#endif
+}
+
+
+#if _lockprof
+/**
+ * Compare two lock statistics by decreasing wait time.
+ *   @left: The left statistics.
+ *   @right: The right statistics.
+ *   &returns: Their order.
+ */
+
+static int stat_cmp(const void *left, const void *right)
+{
+	const struct _lockstat_t *a = left, *b = right;
+
+	if(a->wait != b->wait)
+		return (a->wait > b->wait) ? -1 : 1;
+
+	return (a->acquires > b->acquires) ? -1 : (a->acquires < b->acquires);
+}
+
+/**
+ * Print a duration with a unit.
+ *   @output: The output.
+ *   @ns: The duration in nanoseconds.
+ */
+
+static void print_time(struct io_output_t output, uint64_t ns)
+{
+	if(ns < 10000) {
+		io_format_uint64(output, ns, 10, 0, false, ' ');
+		io_print_str(output, "ns");
+	}
+	else if(ns < 10000000) {
+		io_format_uint64(output, ns / 1000, 10, 0, false, ' ');
+		io_print_str(output, "us");
+	}
+	else {
+		io_format_uint64(output, ns / 1000000, 10, 0, false, ' ');
+		io_print_str(output, "ms");
+	}
+}
+#endif
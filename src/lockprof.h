@@ -0,0 +1,10 @@
+#ifndef LOCKPROF_H
+#define LOCKPROF_H
+
+/*
+ * lock profiler function declarations
+ */
+
+void lockprof_write(struct io_output_t output);
+
+#endif
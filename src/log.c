@@ -0,0 +1,286 @@
+#include "common.h"
+#include "log.h"
+#include "io/output.h"
+#include "io/print.h"
+#include "posix/inc.h"
+#include "posix/time.h"
+#include "try.h"
+
+
+/**
+ * Line buffer structure.
+ *   @i, len: The index and length.
+ *   @store: The buffer storage.
+ */
+
+struct buf_t {
+	size_t i, len;
+	char *store;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static void sink_set(struct io_output_t output, bool open);
+
+static struct buf_t *buf_get(void);
+static void buf_delete(void *ref);
+
+static bool buf_ctrl(struct buf_t *buf, unsigned int id, void *data);
+static void buf_close(struct buf_t *buf);
+static size_t buf_write(struct buf_t *buf, const void *restrict ptr, size_t nbytes);
+
+/*
+ * global variables
+ */
+
+_export enum log_level_e log_level = log_info_e;
+
+/*
+ * local variables
+ */
+
+static _specific_t specific;
+static _mutex_t lock = _MUTEX_INIT;
+static struct io_output_t sink;
+static bool opened = false;
+static int64_t epoch;
+
+static const char *names[] = { "trace", "debug", "info", "warn", "error", "off" };
+
+
+/**
+ * Initialize the logger.
+ */
+
+void _log_init(void)
+{
+	_mutex_name(&lock, "log");
+	specific = _specific_alloc(buf_delete);
+	epoch = _clock_monotonic_coarse();
+	sink = io_stderr;
+}
+
+/**
+ * Destroy the logger.
+ */
+
+void _log_destroy(void)
+{
+	struct buf_t *buf;
+
+	buf = _specific_get(specific);
+	if(buf != NULL)
+		buf_delete(buf);
+
+	if(opened)
+		io_output_close(sink);
+
+	opened = false;
+	_specific_free(specific);
+}
+
+
+/**
+ * Set the log sink. Lines are committed to the sink with a single write.
+ *   @output: The output.
+ */
+
+_export
+void log_sink(struct io_output_t output)
+{
+	sink_set(output, false);
+}
+
+/**
+ * Open a file as the log sink, appending to any existing log.
+ *   @path: The path.
+ */
+
+_export
+void log_open(const char *path)
+{
+	sink_set(io_output_open(path, io_append_e), true);
+}
+
+
+/**
+ * Write a message to the log.
+ *   @file: Optional. The source file.
+ *   @line: The source line.
+ *   @level: The level.
+ *   @format: The printf-style format.
+ *   @...: The printf-style arguments.
+ */
+
+_export
+void _log_write(const char *restrict file, unsigned long line, enum log_level_e level, const char *restrict format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	_log_vwrite(file, line, level, format, args);
+	va_end(args);
+}
+
+/**
+ * Write a message to the log using a variable argument list. The line is
+ * formatted into a per-thread buffer and committed atomically to the sink.
+ * The prefix uses the coarse clock, which never throws and avoids a full
+ * clock read per line.
+ *   @file: Optional. The source file.
+ *   @line: The source line.
+ *   @level: The level.
+ *   @format: The printf-style format.
+ *   @args: The variable argument list.
+ */
+
+_export
+void _log_vwrite(const char *restrict file, unsigned long line, enum log_level_e level, const char *restrict format, va_list args)
+{
+	int64_t now;
+	struct buf_t *buf;
+	struct io_output_t output;
+	static const struct io_output_i iface = { { (io_ctrl_f)buf_ctrl, (io_close_f)buf_close }, (io_write_f)buf_write };
+
+	buf = buf_get();
+	buf->i = 0;
+	output = (struct io_output_t){ buf, &iface };
+
+	now = (_clock_monotonic_coarse() - epoch) / 1000;
+	io_printf(output, "[%u.%06u] %-5s ", (unsigned int)(now / 1000000), (unsigned int)(now % 1000000), log_name(level));
+
+	if(file != NULL)
+		io_printf(output, "%s:%u: ", file, (unsigned int)line);
+
+	io_vprintf(output, format, args);
+	io_print_char(output, '\n');
+
+	_mutex_lock(&lock);
+	io_output_full(sink, buf->store, buf->i);
+	_mutex_unlock(&lock);
+}
+
+
+/**
+ * Retrieve the name of a log level.
+ *   @level: The level.
+ *   &returns: The name.
+ */
+
+_export
+const char *log_name(enum log_level_e level)
+{
+	return (level <= log_off_e) ? names[level] : "unknown";
+}
+
+
+/**
+ * Replace the sink, closing the previous sink if it was opened by the logger.
+ *   @output: The output.
+ *   @open: Flag indicating the output is owned by the logger.
+ */
+
+static void sink_set(struct io_output_t output, bool open)
+{
+	_mutex_lock(&lock);
+
+	if(opened)
+		io_output_close(sink);
+
+	sink = output;
+	opened = open;
+
+	_mutex_unlock(&lock);
+}
+
+
+/**
+ * Retrieve the line buffer for the current thread, creating it if needed.
+ *   &returns: The buffer.
+ */
+
+static struct buf_t *buf_get(void)
+{
+	struct buf_t *buf;
+
+	buf = _specific_get(specific);
+	if(buf != NULL)
+		return buf;
+
+	buf = malloc(sizeof(struct buf_t));
+	buf->i = 0;
+	buf->len = 256;
+	buf->store = malloc(buf->len);
+
+	_specific_set(specific, buf);
+
+	return buf;
+}
+
+/**
+ * Delete a line buffer.
+ *   @ref: The buffer reference.
+ */
+
+static void buf_delete(void *ref)
+{
+	struct buf_t *buf = ref;
+
+	free(buf->store);
+	free(buf);
+}
+
+
+/**
+ * Handle a control signal for a line buffer.
+ *   @buf: The buffer.
+ *   @id: The control identifier.
+ *   @data: The control data.
+ *   &returns: True if the signal is handle, false otherwise.
+ */
+
+static bool buf_ctrl(struct buf_t *buf, unsigned int id, void *data)
+{
+	if(id == io_tell_e)
+		*(uint64_t *)data = buf->i;
+	else
+		return false;
+
+	return true;
+}
+
+/**
+ * Close a line buffer output.
+ *   @buf: The buffer.
+ */
+
+static void buf_close(struct buf_t *buf)
+{
+}
+
+/**
+ * Write to a line buffer.
+ *   @buf: The buffer.
+ *   @ptr: The data.
+ *   @nbytes: The number of bytes to write.
+ *   &returns: The number of bytes written.
+ */
+
+static size_t buf_write(struct buf_t *buf, const void *restrict ptr, size_t nbytes)
+{
+	if(buf->i + nbytes > buf->len) {
+		do
+			buf->len *= 2;
+		while(buf->i + nbytes > buf->len);
+
+		buf->store = realloc(buf->store, buf->len);
+	}
+
+	memcpy(buf->store + buf->i, ptr, nbytes);
+	buf->i += nbytes;
+
+	return nbytes;
+}
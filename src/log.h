@@ -0,0 +1,81 @@
+#ifndef LOG_H
+#define LOG_H
+
+/**
+ * Log level enumerator.
+ *   @log_trace_e: Trace.
+ *   @log_debug_e: Debug.
+ *   @log_info_e: Information.
+ *   @log_warn_e: Warning.
+ *   @log_error_e: Error.
+ *   @log_off_e: Logging disabled.
+ */
+
+enum log_level_e {
+	log_trace_e,
+	log_debug_e,
+	log_info_e,
+	log_warn_e,
+	log_error_e,
+	log_off_e
+};
+
+/*
+ * compile-time minimum log level
+ */
+
+#ifndef LOG_MINLEVEL
+#	define LOG_MINLEVEL log_trace_e
+#endif
+
+
+/*
+ * log variables
+ */
+
+extern enum log_level_e log_level;
+
+/*
+ * log function declarations
+ */
+
+void _log_init(void);
+void _log_destroy(void);
+
+void log_sink(struct io_output_t output);
+void log_open(const char *path);
+
+void _log_write(const char *restrict file, unsigned long line, enum log_level_e level, const char *restrict format, ...);
+void _log_vwrite(const char *restrict file, unsigned long line, enum log_level_e level, const char *restrict format, va_list args);
+
+const char *log_name(enum log_level_e level);
+
+/*
+ * log macros
+ */
+
+#if _test || _debug
+#	define log_msg(level, ...) do { if(((level) >= LOG_MINLEVEL) && ((level) >= log_level)) _log_write(__FILE__, __LINE__, level, __VA_ARGS__); } while(0)
+#else
+#	define log_msg(level, ...) do { if(((level) >= LOG_MINLEVEL) && ((level) >= log_level)) _log_write(NULL, 0, level, __VA_ARGS__); } while(0)
+#endif
+
+#define log_trace(...) log_msg(log_trace_e, __VA_ARGS__)
+#define log_debug(...) log_msg(log_debug_e, __VA_ARGS__)
+#define log_info(...) log_msg(log_info_e, __VA_ARGS__)
+#define log_warn(...) log_msg(log_warn_e, __VA_ARGS__)
+#define log_error(...) log_msg(log_error_e, __VA_ARGS__)
+
+
+/**
+ * Check if a log level is enabled.
+ *   @level: The level.
+ *   &returns: True if enabled, false otherwise.
+ */
+
+static inline bool log_enabled(enum log_level_e level)
+{
+	return (level >= LOG_MINLEVEL) && (level >= log_level);
+}
+
+#endif
@@ -2,6 +2,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include "mem.h"
+#include "prof.h"
+#include "res.h"
+#include "try.h"
+
+
+/*
+ * local function declarations
+ */
+
+static inline void budget_check(struct res_info_t *info, int64_t delta);
+static inline void budget_add(struct res_info_t *info, int64_t delta);
+static inline void budget_charge(struct res_info_t *info, int64_t delta);
 
 
 _export
@@ -17,7 +29,10 @@ void _free(void *ptr)
 }
 
 /**
- * Allocate memory.
+ * Allocate memory. When memory is untracked, the allocation has no header
+ * and is only released by the current scope if the scope is an arena. The
+ * bytes are charged to the current scope, throwing if its budget would be
+ * exceeded.
  *   @nbytes: The number of bytes.
  *   &returns: The allocated memory.
  */
@@ -26,16 +41,35 @@ _export
 void *mem_alloc(size_t nbytes)
 {
 	void *ptr;
+	struct res_info_t *info;
+
+	info = res_info();
+	if(info->arena) {
+		budget_charge(info, nbytes);
+
+		return _res_carve(info, nbytes);
+	}
+
+#if _notrack
+	budget_charge(info, _slab_round(nbytes));
+	ptr = _slab_alloc(nbytes);
+#else
 	struct _res_mem_t *mem;
 
-	mem = ptr = malloc(nbytes + sizeof(struct _res_mem_t));
+	budget_charge(info, nbytes);
+	mem = _slab_alloc(nbytes + sizeof(struct _res_mem_t));
 	_res_add(mem, nbytes);
+	ptr = mem + 1;
+#endif
+
+	_prof_alloc(ptr, nbytes);
 
-	return ptr + sizeof(struct _res_mem_t);
+	return ptr;
 }
 
 /**
- * Reallocate memory.
+ * Reallocate memory. Memory carved by another thread is copied into a new
+ * allocation charged to the current scope.
  *   @ptr: The original pointer.
  *   @nbytes: The number of bytes.
  *   &returns: The new pointer.
@@ -44,18 +78,79 @@ void *mem_alloc(size_t nbytes)
 _export
 void *mem_realloc(void *ptr, size_t nbytes)
 {
-	struct _res_mem_t *mem;
+	struct res_info_t *info;
 
 	if(ptr == NULL)
 		return mem_alloc(nbytes);
 
+	info = res_info();
+
+#if _notrack
+	size_t size;
+
+	if(_slab_isspan(ptr)) {
+		if(((struct _res_mem_t *)ptr - 1)->owner != info->thread)
+			return _res_recarve((struct _res_mem_t *)ptr - 1, nbytes);
+
+		size = (size_t)((struct _res_mem_t *)ptr - 1)->next;
+		budget_check(info, (int64_t)nbytes - (int64_t)size);
+		ptr = _res_recarve((struct _res_mem_t *)ptr - 1, nbytes);
+		budget_add(info, (int64_t)nbytes - (int64_t)size);
+
+		return ptr;
+	}
+
+	size = _slab_size(ptr);
+	budget_check(info, (int64_t)_slab_round(nbytes) - (int64_t)size);
+
+	_prof_free(ptr);
+	ptr = _slab_realloc(ptr, nbytes);
+	_prof_alloc(ptr, nbytes);
+	budget_add(info, (int64_t)_slab_size(ptr) - (int64_t)size);
+
+	return ptr;
+#else
+	struct res_info_t *holder;
+	struct _res_mem_t *mem;
+	int64_t delta;
+
 	mem = ptr -= sizeof(struct _res_mem_t);
+	if(_res_iscarved(mem)) {
+		if(mem->owner != info->thread)
+			return _res_recarve(mem, nbytes);
+
+		delta = (int64_t)nbytes - (int64_t)(size_t)mem->next;
+		budget_check(info, delta);
+		ptr = _res_recarve(mem, nbytes);
+		budget_add(info, delta);
+
+		return ptr;
+	}
+	else if(mem->owner != info->thread) {
+		size_t size = _slab_size(mem) - sizeof(struct _res_mem_t);
+
+		ptr = mem_alloc(nbytes);
+		mem_copy(ptr, mem + 1, (size < nbytes) ? size : nbytes);
+		mem_free(mem + 1);
 
+		return ptr;
+	}
+
+	holder = _res_holder(info, mem);
+	delta = (int64_t)nbytes - ((holder == info) ? (int64_t)mem->nbytes : 0);
+	budget_check(info, delta);
+	if(holder != info)
+		budget_add(holder, -(int64_t)mem->nbytes);
+
+	_prof_free(mem + 1);
 	_res_remove(mem);
-	mem = ptr = realloc(ptr, nbytes + sizeof(struct _res_mem_t));
+	mem = _slab_realloc(mem, nbytes + sizeof(struct _res_mem_t));
 	_res_add(mem, nbytes);
+	_prof_alloc(mem + 1, nbytes);
+	budget_add(info, delta);
 
-	return ptr + sizeof(struct _res_mem_t);
+	return mem + 1;
+#endif
 }
 
 /**
@@ -79,12 +174,81 @@ void _mem_set(void **dest, void *src)
 _export
 void mem_free(void *ptr)
 {
+#if _notrack
+	if(_slab_isspan(ptr))
+		_res_uncarve((struct _res_mem_t *)ptr - 1);
+	else {
+		budget_add(res_info(), -(int64_t)_slab_size(ptr));
+		_prof_free(ptr);
+		_slab_free(ptr);
+	}
+#else
+	struct res_info_t *info;
 	struct _res_mem_t *mem;
 
 	mem = ptr -= sizeof(struct _res_mem_t);
+	if(_res_iscarved(mem)) {
+		_res_uncarve(mem);
+		return;
+	}
 
-	_res_remove(mem);
-	free(ptr);
+	info = res_info();
+	if(mem->owner == info->thread)
+		budget_add(_res_holder(info, mem), -(int64_t)mem->nbytes);
+
+	_prof_free(mem + 1);
+	if(_res_remove(mem))
+		_slab_free(mem);
+#endif
+}
+
+/**
+ * Allocate untracked memory. Untracked memory is never released by the
+ * resource scopes and must be freed with 'mem_free_untracked'.
+ *   @nbytes: The number of bytes.
+ *   &returns: The allocated memory.
+ */
+
+_export
+void *mem_alloc_untracked(size_t nbytes)
+{
+	void *ptr;
+
+	ptr = _slab_alloc(nbytes);
+	_prof_alloc(ptr, nbytes);
+
+	return ptr;
+}
+
+/**
+ * Reallocate untracked memory.
+ *   @ptr: The original pointer.
+ *   @nbytes: The number of bytes.
+ *   &returns: The new pointer.
+ */
+
+_export
+void *mem_realloc_untracked(void *ptr, size_t nbytes)
+{
+	if(ptr != NULL)
+		_prof_free(ptr);
+
+	ptr = _slab_realloc(ptr, nbytes);
+	_prof_alloc(ptr, nbytes);
+
+	return ptr;
+}
+
+/**
+ * Free untracked memory.
+ *   @ptr: The pointer.
+ */
+
+_export
+void mem_free_untracked(void *ptr)
+{
+	_prof_free(ptr);
+	_slab_free(ptr);
 }
 
 /**
@@ -119,7 +283,8 @@ void mem_erase(void *ptr)
 
 void _mem_release(struct _res_mem_t *mem)
 {
-	free(mem);
+	_prof_free(mem + 1);
+	_slab_free(mem);
 }
 
 
@@ -152,7 +317,7 @@ void *mem_dup(void *ptr, size_t nbytes)
 _export
 void mem_copy(void *restrict dest, const void *restrict src, size_t nbytes)
 {
-	memcpy(dest, src, nbytes);
+	__builtin_memcpy(dest, src, nbytes);
 }
 
 /**
@@ -165,24 +330,24 @@ void mem_copy(void *restrict dest, const void *restrict src, size_t nbytes)
 _export
 void mem_move(void *dest, const void *src, size_t nbytes)
 {
-	memmove(dest, src, nbytes);
+	__builtin_memmove(dest, src, nbytes);
 }
 
 /**
  * Zero the memory.
- *   @mem: The destination.
+ *   @dest: The destination.
  *   @nbytes: The number of bytes.
  */
 
 _export
 void mem_zero(void *dest, size_t nbytes)
 {
-	memset(dest, 0x00, nbytes);
+	__builtin_memset(dest, 0x00, nbytes);
 }
 
 /**
  * Swap two pieces of memory.
- *   @left: The left meomry.
+ *   @left: The left memory.
  *   @right: The right memory.
  *   @nbytes: The number of bytes.
  */
@@ -190,15 +355,21 @@ void mem_zero(void *dest, size_t nbytes)
 _export
 void mem_swap(void *left, void *right, size_t nbytes)
 {
-	uint8_t t, *lptr = left, *rptr = right;
-
-	while(nbytes-- > 0) {
-		t = *lptr;
-		*lptr++ = *rptr;
-		*rptr++ = t;
-	}
+	_simd_swap(left, right, nbytes);
 }
 
+/**
+ * Check if memory is all zero.
+ *   @ptr: The memory.
+ *   @nbytes: The number of bytes.
+ *   &returns: True if all bytes are zero.
+ */
+
+_export
+bool mem_iszero(const void *ptr, size_t nbytes)
+{
+	return _simd_iszero(ptr, nbytes);
+}
 
 /**
  * Compare to memory buffers to see if they are equal.
@@ -211,5 +382,44 @@ void mem_swap(void *left, void *right, size_t nbytes)
 _export
 bool mem_isequal(const void *left, const void *right, size_t nbytes)
 {
-	return memcmp(left, right, nbytes) == 0;
+	return __builtin_memcmp(left, right, nbytes) == 0;
+}
+
+
+/**
+ * Check that growing a scope's memory stays within its budget.
+ *   @info: The scope.
+ *   @delta: The change in bytes.
+ */
+
+static inline void budget_check(struct res_info_t *info, int64_t delta)
+{
+	if((delta > 0) && (info->usage.nbytes + delta > info->usage.budget))
+		throw("Memory budget exceeded.");
+}
+
+/**
+ * Account a change to a scope's memory, tracking its peak.
+ *   @info: The scope.
+ *   @delta: The change in bytes.
+ */
+
+static inline void budget_add(struct res_info_t *info, int64_t delta)
+{
+	info->usage.nbytes += delta;
+	if(info->usage.nbytes > info->usage.peak)
+		info->usage.peak = info->usage.nbytes;
+}
+
+/**
+ * Check and account a new allocation for a scope.
+ *   @info: The scope.
+ *   @delta: The number of bytes.
+ */
+
+static inline void budget_charge(struct res_info_t *info, int64_t delta)
+{
+	budget_check(info, delta);
+	budget_add(info, delta);
+	info->usage.nallocs++;
 }
@@ -15,14 +15,14 @@ void mem_free(void *ptr);
 void _mem_freelc(unsigned int nptrs, void **ptrs);
 void mem_erase(void *ptr);
 
+void *mem_alloc_untracked(size_t nbytes);
+void *mem_realloc_untracked(void *ptr, size_t nbytes);
+void mem_free_untracked(void *ptr);
+
 void *mem_dup(void *ptr, size_t nbytes);
 
-void mem_copy(void *restrict dest, const void *restrict src, size_t nbytes);
-void mem_move(void *dest, const void *src, size_t nbytes);
-void mem_zero(void *dest, size_t nbytes);
 void mem_swap(void *left, void *right, size_t nbytes);
-
-bool mem_isequal(const void *left, const void *right, size_t nbytes);
+bool mem_iszero(const void *ptr, size_t nbytes);
 
 /*
  * convenience macros
@@ -36,4 +36,53 @@ bool mem_isequal(const void *left, const void *right, size_t nbytes);
 
 #define getcontainer(ptr, type, member) ((type *)((void *)(ptr) - offsetof(type, member)))
 
+
+/**
+ * Copy non-overlapping data.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ */
+
+_inline void mem_copy(void *restrict dest, const void *restrict src, size_t nbytes)
+{
+	__builtin_memcpy(dest, src, nbytes);
+}
+
+/**
+ * Copy possibly overlapping data.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ */
+
+_inline void mem_move(void *dest, const void *src, size_t nbytes)
+{
+	__builtin_memmove(dest, src, nbytes);
+}
+
+/**
+ * Zero the memory.
+ *   @dest: The destination.
+ *   @nbytes: The number of bytes.
+ */
+
+_inline void mem_zero(void *dest, size_t nbytes)
+{
+	__builtin_memset(dest, 0x00, nbytes);
+}
+
+/**
+ * Compare to memory buffers to see if they are equal.
+ *   @left: The left buffer.
+ *   @right: The right buffer.
+ *   @nbytes: The number of bytes to compare.
+ *   &returns: True if equal, false otherwise.
+ */
+
+_inline bool mem_isequal(const void *left, const void *right, size_t nbytes)
+{
+	return __builtin_memcmp(left, right, nbytes) == 0;
+}
+
 #endif
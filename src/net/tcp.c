@@ -7,6 +7,7 @@
 #include "../posix/inc.h"
 #include "../types/func.h"
 #include "../types/list.h"
+#include "../types/pool.h"
 
 
 /*
@@ -21,6 +22,7 @@
  *   @sock: The socket.
  *   @defsize: The default read size.
  *   @in, out: The input and output data lists.
+ *   @pool: The data block pool.
  *   @events: The pending events.
  */
 
@@ -29,6 +31,7 @@ struct tcp_client_t {
 
 	size_t defsize;
 	struct list_root_t in, out;
+	struct pool_t *pool;
 
 	unsigned int events;
 };
@@ -42,6 +45,13 @@ struct tcp_server_t {
 	_socket_t sock;
 };
 
+/**
+ * Data block structure, holding up to 'DEFSIZE' bytes.
+ *   @node: The list node.
+ *   @idx, len: The current index and length.
+ *   @buf: The buffer.
+ */
+
 struct data_t {
 	struct list_node_t node;
 
@@ -54,6 +64,7 @@ struct data_t {
  */
 
 static size_t output_proc(void *ref, const void *restrict buf, size_t nbytes);
+static void client_trim(struct tcp_client_t *client);
 
 static struct data_t *data_first(struct list_root_t *root);
 static struct data_t *data_next(struct data_t *data);
@@ -74,6 +85,7 @@ struct tcp_client_t *tcp_client_new(_socket_t sock)
 	client->sock = sock;
 	client->defsize = 16*1024;
 	client->in = client->out = list_root_init();
+	client->pool = pool_new(sizeof(struct data_t) + DEFSIZE, false);
 
 	return client;
 }
@@ -99,8 +111,7 @@ struct tcp_client_t *tcp_client_open(const char *host, uint16_t port)
 _export
 void tcp_client_close(struct tcp_client_t *client)
 {
-	list_root_destroy(&client->in, offsetof(struct data_t, node), mem_free);
-	list_root_destroy(&client->out, offsetof(struct data_t, node), mem_free);
+	pool_delete(client->pool);
 	_socket_close(client->sock);
 	mem_free(client);
 }
@@ -144,7 +155,8 @@ struct _poll_t tcp_client_poll(struct tcp_client_t *client)
 
 
 /**
- * Process data on a client.
+ * Process data on a client. Reads go into the tail of the last input block
+ * while it has room, so small messages do not each hold a block.
  *   @client: The client.
  *   @events: The events.
  */
@@ -155,12 +167,22 @@ void tcp_client_proc(struct tcp_client_t *client, enum _poll_e events)
 	if(events & _poll_in_e) {
 		struct data_t *data;
 
-		data = mem_alloc(sizeof(struct data_t) + DEFSIZE);
-		data->idx = 0;
-		data->len = _socket_read(client->sock, data->buf, DEFSIZE);
-
-		data = mem_realloc(data, sizeof(struct data_t) + data->len);
-		list_root_append(&client->in, &data->node);
+		data = client->in.tail ? getcontainer(client->in.tail, struct data_t, node) : NULL;
+
+		if((data != NULL) && (data->len < DEFSIZE))
+			data->len += _socket_read(client->sock, data->buf + data->len, DEFSIZE - data->len);
+		else {
+			data = pool_alloc(client->pool);
+			data->idx = 0;
+			data->len = _socket_read(client->sock, data->buf, DEFSIZE);
+
+			if(data->len > 0)
+				list_root_append(&client->in, &data->node);
+			else {
+				pool_free(client->pool, data);
+				client_trim(client);
+			}
+		}
 
 		client->events &= ~_poll_in_e;
 	}
@@ -175,9 +197,11 @@ void tcp_client_proc(struct tcp_client_t *client, enum _poll_e events)
 
 			next = data_next(data);
 			list_root_remove(&client->out, &data->node);
-			mem_free(data);
+			pool_free(client->pool, data);
 		}
 
+		client_trim(client);
+
 		client->events &= ~_poll_out_e;
 	}
 }
@@ -257,6 +281,7 @@ bool tcp_read(struct tcp_client_t *client, void *restrict buf, size_t nbytes)
 
 		mem_copy(buf, data->buf + data->idx, len);
 
+		buf += len;
 		nbytes -= len;
 		data->idx += len;
 
@@ -265,14 +290,17 @@ bool tcp_read(struct tcp_client_t *client, void *restrict buf, size_t nbytes)
 
 		next = data_next(data);
 		list_root_remove(&client->in, &data->node);
-		mem_free(data);
+		pool_free(client->pool, data);
 	}
 
+	client_trim(client);
+
 	return true;
 }
 
 /**
- * Write data to a TCP connection.
+ * Write data to a TCP connection. The data is queued in blocks of at most
+ * 'DEFSIZE' bytes.
  *   @client: The client.
  *   @buf: The buffer.
  *   @nbytes: The number of bytes.
@@ -281,15 +309,23 @@ bool tcp_read(struct tcp_client_t *client, void *restrict buf, size_t nbytes)
 _export
 void tcp_write(struct tcp_client_t *client, const void *restrict buf, size_t nbytes)
 {
+	size_t len;
 	struct data_t *data;
 
-	data = mem_alloc(sizeof(struct data_t) + nbytes);
-	data->idx = 0;
-	data->len = nbytes;
-	mem_copy(data->buf, buf, nbytes);
+	while(nbytes > 0) {
+		len = m_min_size(nbytes, DEFSIZE);
+
+		data = pool_alloc(client->pool);
+		data->idx = 0;
+		data->len = len;
+		mem_copy(data->buf, buf, len);
+		list_root_append(&client->out, &data->node);
+
+		buf += len;
+		nbytes -= len;
+	}
 
 	client->events |= _poll_out_e;
-	list_root_append(&client->out, &data->node);
 }
 
 /**
@@ -347,6 +383,18 @@ static size_t output_proc(void *ref, const void *restrict buf, size_t nbytes)
 	return nbytes;
 }
 
+/**
+ * Trim the block pool of a client once both of its lists are drained, so an
+ * idle connection does not hold the blocks of its largest burst.
+ *   @client: The client.
+ */
+
+static void client_trim(struct tcp_client_t *client)
+{
+	if((client->in.head == NULL) && (client->out.head == NULL))
+		pool_trim(client->pool);
+}
+
 
 /**
  * Open a server on a port.
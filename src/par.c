@@ -0,0 +1,235 @@
+#include "common.h"
+#include "par.h"
+#include "mem.h"
+#include "string.h"
+#include "thrpool.h"
+#include "try.h"
+
+
+/*
+ * parallel definitions
+ */
+
+#define PAR_LINE	64
+#define PAR_SPLIT	8
+
+/**
+ * Parallel job structure.
+ *   @next, end: The next unclaimed index and the end index.
+ *   @grain: The number of indices claimed at once.
+ *   @func, reduce: The range and reduction callbacks, only one is set.
+ *   @arg: The argument.
+ */
+
+struct par_t {
+	size_t next, end, grain;
+
+	par_for_f func;
+	par_reduce_f reduce;
+	void *arg;
+};
+
+/**
+ * Share structure, one per worker.
+ *   @par: The job.
+ *   @acc: The partial accumulator, or null.
+ */
+
+struct share_t {
+	struct par_t *par;
+	void *acc;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static char *run(struct thrpool_t *pool, struct par_t *par, uint8_t *acc, size_t stride);
+static void *share_proc(void *arg);
+static _noreturn void rethrow(char *error);
+
+
+/**
+ * Run a function over a range in parallel. The range is claimed in chunks
+ * of 'grain' indices by one share per worker of the current pool, or of
+ * the global pool if not called from a worker. An error thrown by the
+ * function is thrown again once all shares have finished.
+ *   @begin: The first index.
+ *   @end: The index past the last.
+ *   @grain: The chunk size, or zero to choose automatically.
+ *   @func: The range callback.
+ *   @arg: The argument.
+ */
+
+_export
+void par_for(size_t begin, size_t end, size_t grain, par_for_f func, void *arg)
+{
+	char *error;
+	struct thrpool_t *pool;
+	struct par_t par = { begin, end, grain, func, NULL, arg };
+
+	if(begin >= end)
+		return;
+
+	if((grain > 0) && (end - begin <= grain)) {
+		func(begin, end, arg);
+		return;
+	}
+
+	pool = thrpool_current();
+	if(pool == NULL)
+		pool = thrpool_global();
+
+	error = run(pool, &par, NULL, 0);
+	if(error != NULL)
+		rethrow(error);
+}
+
+/**
+ * Reduce a range in parallel. Each worker accumulates into its own partial
+ * result, initialized from 'init'; the partial results are then merged
+ * into 'result' in worker order.
+ *   @begin: The first index.
+ *   @end: The index past the last.
+ *   @grain: The chunk size, or zero to choose automatically.
+ *   @result: The result, merged with the partial results.
+ *   @init: The initial value of each partial result.
+ *   @nbytes: The size of a result.
+ *   @func: The reduction callback.
+ *   @merge: The merge callback.
+ *   @arg: The argument.
+ */
+
+_export
+void par_reduce(size_t begin, size_t end, size_t grain, void *result, const void *init, size_t nbytes, par_reduce_f func, par_merge_f merge, void *arg)
+{
+	char *error;
+	unsigned int i, n;
+	size_t stride;
+	uint8_t *acc;
+	struct thrpool_t *pool;
+	struct par_t par = { begin, end, grain, NULL, func, arg };
+
+	if(begin >= end)
+		return;
+
+	if((grain > 0) && (end - begin <= grain)) {
+		uint8_t local[nbytes];
+
+		mem_copy(local, init, nbytes);
+		func(begin, end, local, arg);
+		merge(result, local, arg);
+
+		return;
+	}
+
+	pool = thrpool_current();
+	if(pool == NULL)
+		pool = thrpool_global();
+
+	n = thrpool_size(pool);
+	stride = (nbytes + PAR_LINE - 1) & ~(size_t)(PAR_LINE - 1);
+
+	acc = mem_alloc(n * stride);
+	for(i = 0; i < n; i++)
+		mem_copy(acc + i * stride, init, nbytes);
+
+	error = run(pool, &par, acc, stride);
+	if(error == NULL) {
+		for(i = 0; i < n; i++)
+			merge(result, acc + i * stride, arg);
+	}
+
+	mem_free(acc);
+
+	if(error != NULL)
+		rethrow(error);
+}
+
+
+/**
+ * Run a job with one share per worker.
+ *   @pool: The pool.
+ *   @par: The job.
+ *   @acc: Optional. The partial accumulators.
+ *   @stride: The distance between accumulators.
+ *   &returns: The first error thrown, freed with 'free', or null.
+ */
+
+static char *run(struct thrpool_t *pool, struct par_t *par, uint8_t *acc, size_t stride)
+{
+	void *ret;
+	char *error = NULL, *err;
+	unsigned int i, n = thrpool_size(pool);
+	struct share_t share[n];
+	struct thrtask_t *task[n];
+
+	if(par->grain == 0) {
+		par->grain = (par->end - par->next) / (n * PAR_SPLIT);
+		if(par->grain == 0)
+			par->grain = 1;
+	}
+
+	for(i = 0; i < n; i++) {
+		share[i] = (struct share_t){ par, acc ? (acc + i * stride) : NULL };
+		task[i] = thrpool_submit(pool, share_proc, &share[i]);
+	}
+
+	for(i = 0; i < n; i++) {
+		err = _thrpool_join(task[i], &ret);
+		if(error == NULL)
+			error = err;
+		else
+			free(err);
+	}
+
+	return error;
+}
+
+/**
+ * Share processing function, claiming chunks until the range is exhausted.
+ *   @arg: The share.
+ *   &returns: Always null.
+ */
+
+static void *share_proc(void *arg)
+{
+	size_t begin, end;
+	struct share_t *share = arg;
+	struct par_t *par = share->par;
+
+	while(true) {
+		begin = __atomic_load_n(&par->next, __ATOMIC_RELAXED);
+		if(begin >= par->end)
+			break;
+
+		begin = __atomic_fetch_add(&par->next, par->grain, __ATOMIC_RELAXED);
+		if(begin >= par->end)
+			break;
+
+		end = (par->end - begin > par->grain) ? (begin + par->grain) : par->end;
+
+		if(share->acc != NULL)
+			par->reduce(begin, end, share->acc, par->arg);
+		else
+			par->func(begin, end, par->arg);
+	}
+
+	return NULL;
+}
+
+/**
+ * Throw an error collected from a share.
+ *   @error: The error, freed before throwing.
+ */
+
+static _noreturn void rethrow(char *error)
+{
+	char msg[str_len(error) + 1];
+
+	mem_copy(msg, error, sizeof(msg));
+	free(error);
+
+	throw("%s", msg);
+}
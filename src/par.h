@@ -0,0 +1,39 @@
+#ifndef PAR_H
+#define PAR_H
+
+/**
+ * Parallel range callback.
+ *   @begin: The first index.
+ *   @end: The index past the last.
+ *   @arg: The argument.
+ */
+
+typedef void (*par_for_f)(size_t begin, size_t end, void *arg);
+
+/**
+ * Parallel reduction callback, accumulating a range into a partial result.
+ *   @begin: The first index.
+ *   @end: The index past the last.
+ *   @acc: The partial accumulator.
+ *   @arg: The argument.
+ */
+
+typedef void (*par_reduce_f)(size_t begin, size_t end, void *acc, void *arg);
+
+/**
+ * Parallel merge callback, folding a partial result into another.
+ *   @dest: The destination accumulator.
+ *   @src: The source accumulator.
+ *   @arg: The argument.
+ */
+
+typedef void (*par_merge_f)(void *dest, const void *src, void *arg);
+
+/*
+ * parallel function declarations
+ */
+
+void par_for(size_t begin, size_t end, size_t grain, par_for_f func, void *arg);
+void par_reduce(size_t begin, size_t end, size_t grain, void *result, const void *init, size_t nbytes, par_reduce_f func, par_merge_f merge, void *arg);
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <dirent.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <unistd.h>
 
 /*
@@ -17,8 +18,9 @@ typedef int _file_t;
 typedef int _fd_t;
 typedef void *_dynlib_t;
 typedef pthread_t _thread_t;
-typedef pthread_mutex_t _mutex_t;
 typedef pthread_cond_t _cond_t;
+typedef pthread_rwlock_t _rwlock_t;
+typedef sem_t _sem_t;
 typedef pthread_key_t _specific_t;
 typedef pthread_once_t _once_t;
 
@@ -35,6 +37,79 @@ typedef int _socket_t;
 #define _stderr STDERR_FILENO
 
 
+/**
+ * Mutex structure. With lock profiling, the mutex carries its statistics
+ * and the time it was acquired.
+ *   @mutex: The mutex.
+ *   @stat: The statistics, allocated on first use.
+ *   @since: The cycle count when acquired.
+ */
+
+#if _lockprof
+typedef struct {
+	pthread_mutex_t mutex;
+	struct _lockstat_t *stat;
+	uint64_t since;
+} _mutex_t;
+#else
+typedef pthread_mutex_t _mutex_t;
+#endif
+
+/**
+ * Adaptive lock structure.
+ *   @state: The state, zero if free, one if held, two if held with waiters.
+ */
+
+typedef struct {
+	uint32_t state;
+} _lock_t;
+
+
+/**
+ * Thread attribute structure.
+ *   @name: Optional. The thread name, truncated to 15 characters.
+ *   @stack: The stack size, or zero for the default.
+ *   @cpus: Optional. The processors the thread may run on.
+ *   @ncpus: The number of processors.
+ *   @node: The NUMA node for the thread's memory, or negative for any.
+ */
+
+struct _thrattr_t {
+	const char *name;
+	size_t stack;
+
+	const unsigned int *cpus;
+	unsigned int ncpus;
+	int node;
+};
+
+/**
+ * Processor structure.
+ *   @id: The processor number.
+ *   @core, package, node: The physical core, package and NUMA node.
+ *   @primary: Set on the first processor of each physical core.
+ */
+
+struct _topocpu_t {
+	unsigned int id;
+	unsigned int core, package, node;
+	bool primary;
+};
+
+/**
+ * Topology structure. Cores and packages are numbered from zero across the
+ * whole machine.
+ *   @cpu: The processor array.
+ *   @ncpus, ncores, npackages, nnodes: The number of online processors,
+ *     physical cores, packages and NUMA nodes.
+ */
+
+struct _topo_t {
+	struct _topocpu_t *cpu;
+	unsigned int ncpus, ncores, npackages, nnodes;
+};
+
+
 /**
  * File system iterator.
  *   @dir: The directory.
@@ -70,16 +145,30 @@ enum _poll_e {
 };
 
 
+/**
+ * Event structure. The event is signaled when 'fd' is readable.
+ *   @fd, wr: The read and write file descriptors, the same for 'eventfd'.
+ */
+
+struct _event_t {
+	_fd_t fd, wr;
+};
+
+
 /**
  * Task structure.
  *   @thread: The thread.
- *   @fd, pipe: The synchronization file descriptor and pipe.
+ *   @fd: The synchronization file descriptor, readable on termination. It
+ *     is an event descriptor; wait with '_task_wait' or poll it, but never
+ *     read it directly.
+ *   @event: The termination event.
  */
 
 struct _task_t {
 	_thread_t thread;
 
-	int fd, pipe[2];
+	int fd;
+	struct _event_t event;
 };
 
 #endif
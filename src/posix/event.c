@@ -0,0 +1,161 @@
+#include "../common.h"
+#include "event.h"
+#include <fcntl.h>
+#include "poll.h"
+#include "../try.h"
+
+#ifdef __linux__
+#	include <sys/eventfd.h>
+#endif
+
+
+/**
+ * Initialize an event. On Linux, the event is an 'eventfd' counter;
+ * elsewhere, it falls back to a non-blocking pipe.
+ *   &returns: The event.
+ */
+
+_export
+struct _event_t _event_init(void)
+{
+	struct _event_t event;
+
+#ifdef __linux__
+	event.fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(event.fd < 0)
+		throw("Failed to create event. %s.", strerror(errno));
+
+	event.wr = event.fd;
+#else
+	int fd[2];
+
+	if(pipe(fd) < 0)
+		throw("Failed to create event. %s.", strerror(errno));
+
+	fcntl(fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(fd[1], F_SETFL, O_NONBLOCK);
+	fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+
+	event.fd = fd[0];
+	event.wr = fd[1];
+#endif
+
+	return event;
+}
+
+/**
+ * Destroy an event.
+ *   @event: The event.
+ */
+
+_export
+void _event_destroy(struct _event_t *event)
+{
+	close(event->fd);
+	if(event->wr != event->fd)
+		close(event->wr);
+}
+
+
+/**
+ * Signal an event, adding to its counter. This may be called from any
+ * thread. With the pipe fallback, a full pipe saturates the counter, but
+ * the event remains signaled.
+ *   @event: The event.
+ *   @cnt: The amount added to the counter.
+ */
+
+_export
+void _event_signal(struct _event_t *event, uint64_t cnt)
+{
+#ifdef __linux__
+	while(write(event->wr, &cnt, sizeof(uint64_t)) < 0) {
+		if(errno == EAGAIN)
+			break;
+		else if(errno != EINTR)
+			fatal("Failed to signal event. %s.", strerror(errno));
+	}
+#else
+	ssize_t ret;
+	uint8_t buf[64] = { 0 };
+
+	while(cnt > 0) {
+		ret = write(event->wr, buf, (cnt < sizeof(buf)) ? cnt : sizeof(buf));
+		if(ret < 0) {
+			if(errno == EAGAIN)
+				break;
+			else if(errno != EINTR)
+				fatal("Failed to signal event. %s.", strerror(errno));
+		}
+		else
+			cnt -= ret;
+	}
+#endif
+}
+
+/**
+ * Reset an event, clearing its counter without waiting.
+ *   @event: The event.
+ *   &returns: The counter before the reset, zero if not signaled.
+ */
+
+_export
+uint64_t _event_reset(struct _event_t *event)
+{
+#ifdef __linux__
+	uint64_t cnt;
+
+	while(read(event->fd, &cnt, sizeof(uint64_t)) < 0) {
+		if(errno == EAGAIN)
+			return 0;
+		else if(errno != EINTR)
+			throw("Failed to read event. %s.", strerror(errno));
+	}
+
+	return cnt;
+#else
+	ssize_t ret;
+	uint64_t cnt = 0;
+	uint8_t buf[256];
+
+	while(true) {
+		ret = read(event->fd, buf, sizeof(buf));
+		if(ret < 0) {
+			if(errno == EAGAIN)
+				break;
+			else if(errno != EINTR)
+				throw("Failed to read event. %s.", strerror(errno));
+		}
+		else if(ret == 0)
+			break;
+		else
+			cnt += ret;
+	}
+
+	return cnt;
+#endif
+}
+
+/**
+ * Wait for an event to be signaled, then reset it. The event may also be
+ * placed in a poll set using its 'fd' member with '_poll_in_e'.
+ *   @event: The event.
+ *   @timeout: The timeout in microseconds. Negative values wait indefinitely.
+ *   &returns: The counter before the reset, zero on timeout.
+ */
+
+_export
+uint64_t _event_wait(struct _event_t *event, int64_t timeout)
+{
+	uint64_t cnt;
+
+	while(true) {
+		if(_poll1(event->fd, _poll_in_e, timeout) == 0)
+			return 0;
+
+		cnt = _event_reset(event);
+		if((cnt > 0) || (timeout >= 0))
+			return cnt;
+	}
+}
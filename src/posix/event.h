@@ -0,0 +1,15 @@
+#ifndef POSIX_EVENT_H
+#define POSIX_EVENT_H
+
+/*
+ * event function declarations
+ */
+
+struct _event_t _event_init(void);
+void _event_destroy(struct _event_t *event);
+
+void _event_signal(struct _event_t *event, uint64_t cnt);
+uint64_t _event_reset(struct _event_t *event);
+uint64_t _event_wait(struct _event_t *event, int64_t timeout);
+
+#endif
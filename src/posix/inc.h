@@ -2,6 +2,7 @@
 #define POSIX_INC_H
 
 #include "err.h"
+#include "event.h"
 #include "file.h"
 #include "fs.h"
 #include "net.h"
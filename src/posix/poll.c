@@ -8,7 +8,9 @@
  * Poll a set of file descriptors.
  *   @fds: THe file descriptor set.
  *   @nfds: The number of file descriptors.
- *   @timeout: The timeout. Negative values wait indefinitely.
+ *   @timeout: The timeout in microseconds, rounded up to milliseconds.
+ *     Negative values wait indefinitely, and zero checks the descriptors
+ *     without waiting.
  *   &returns: The number of signalled file descriptors.
  */
 
@@ -30,7 +32,7 @@ unsigned int _poll(struct _poll_t *fds, unsigned int nfds, int64_t timeout)
 			set[i].events |= POLLOUT;
 	}
 
-	n = poll(set, nfds, (timeout > 0) ? (timeout / 1000) : -1);
+	n = poll(set, nfds, (timeout >= 0) ? ((timeout + 999) / 1000) : -1);
 	if(n < 0)
 		throw("Poll failed. %s.", strerror(errno));
 
@@ -51,7 +53,7 @@ unsigned int _poll(struct _poll_t *fds, unsigned int nfds, int64_t timeout)
  * Poll a single file descriptor.
  *   @fd: The file descriptor.
  *   @events: The sought events.
- *   @timeout: The timout.
+ *   @timeout: The timeout in microseconds, as for '_poll'.
  *   &returns: The response events. Zero indicates timeout.
  */
 
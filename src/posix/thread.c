@@ -1,7 +1,69 @@
+#define _GNU_SOURCE
 #include "../common.h"
 #include "thread.h"
+#include <dirent.h>
+#include <sched.h>
+#include <time.h>
+#include "event.h"
+#include "poll.h"
+#include "time.h"
 #include "../try.h"
 
+#ifdef __linux__
+#	include <linux/futex.h>
+#	include <linux/mempolicy.h>
+#	include <sys/syscall.h>
+#endif
+
+
+/*
+ * adaptive lock definitions
+ */
+
+#define LOCK_SPIN	100
+
+/*
+ * mutex definitions
+ */
+
+#if _lockprof
+#	define MUTEX(ptr) (&(ptr)->mutex)
+#else
+#	define MUTEX(ptr) (ptr)
+#endif
+
+/*
+ * lock profiling variables
+ */
+
+#if _lockprof
+static _lock_t registry = _LOCK_INIT;
+static struct _lockstat_t *live = NULL, *retired = NULL;
+#endif
+
+/*
+ * topology definitions
+ */
+
+#define TOPO_SYS	"/sys/devices/system/cpu"
+#define TOPO_NODES	1024
+
+/**
+ * Thread start structure.
+ *   @func: The function.
+ *   @arg: The argument.
+ *   @name: The name, empty if unnamed.
+ *   @node: The NUMA node, or negative for any.
+ */
+
+struct start_t {
+	void *(*func)(void *);
+	void *arg;
+
+	char name[16];
+	int node;
+};
+
 /**
  * Task information structure.
  *   @func: The function.
@@ -19,8 +81,23 @@ struct info_t {
  * local function declarations
  */
 
+static void *thread_proc(void *arg);
 static void *task_proc(void *arg);
 
+#if _lockprof
+static struct _lockstat_t *lockstat(_mutex_t *mutex);
+static void lock_retire(struct _lockstat_t *stat);
+static void lock_acquire(_mutex_t *mutex, uint64_t start);
+static void lock_release(_mutex_t *mutex);
+#endif
+
+static void attr_affinity(pthread_attr_t *pattr, const struct _thrattr_t *attr);
+static long topo_read(unsigned int cpu, const char *file);
+static int topo_node(unsigned int cpu);
+
+static struct timespec deadline(clockid_t clock, int64_t timeout);
+static inline void relax(void);
+
 /**
  * Execute a function only once.
  *   @once: The control.
@@ -38,7 +115,8 @@ void _thread_once(_once_t *once, void (*func)(void))
 }
 
 /**
- * Create a new thread.
+ * Create a new thread. The thread starts with its own resource structure,
+ * and any left on return are popped.
  *   @func: The function.
  *   @arg: The argument.
  *   &returns: The thread.
@@ -46,17 +124,177 @@ void _thread_once(_once_t *once, void (*func)(void))
 
 _export
 _thread_t _thread_new(void *(*func)(void *), void *arg)
+{
+	return _thread_new_attr(func, arg, NULL);
+}
+
+/**
+ * Create a new thread with attributes. A NUMA node without processors
+ * restricts the thread to the processors of that node.
+ *   @func: The function.
+ *   @arg: The argument.
+ *   @attr: Optional. The attributes.
+ *   &returns: The thread.
+ */
+
+_export
+_thread_t _thread_new_attr(void *(*func)(void *), void *arg, const struct _thrattr_t *attr)
 {
 	int err;
 	_thread_t thread;
-
-	err = pthread_create(&thread, NULL, func, arg);
-	if(err != 0)
+	pthread_attr_t pattr;
+	struct start_t *start;
+
+	start = malloc(sizeof(struct start_t));
+	*start = (struct start_t){ func, arg, "", -1 };
+
+	pthread_attr_init(&pattr);
+
+	if(attr != NULL) {
+		if(attr->name != NULL)
+			snprintf(start->name, sizeof(start->name), "%s", attr->name);
+
+		if(attr->stack > 0) {
+			err = pthread_attr_setstacksize(&pattr, attr->stack);
+			if(err != 0) {
+				free(start);
+				pthread_attr_destroy(&pattr);
+				throw("Failed to set thread stack size. %s.", strerror(err));
+			}
+		}
+
+		start->node = attr->node;
+		attr_affinity(&pattr, attr);
+	}
+
+	err = pthread_create(&thread, &pattr, thread_proc, start);
+	pthread_attr_destroy(&pattr);
+	if(err != 0) {
+		free(start);
 		throw("Failed to create thread. %s.", strerror(err));
+	}
 
 	return thread;
 }
 
+/**
+ * Initialize thread attributes to their defaults.
+ *   &returns: The attributes.
+ */
+
+_export
+struct _thrattr_t _thrattr_init(void)
+{
+	return (struct _thrattr_t){ NULL, 0, NULL, 0, -1 };
+}
+
+/**
+ * Yield the processor to another thread.
+ */
+
+_export
+void _thread_yield(void)
+{
+	sched_yield();
+}
+
+/**
+ * Retrieve the number of online processors.
+ *   &returns: The number of processors, at least one.
+ */
+
+_export
+unsigned int _thread_ncpus(void)
+{
+	long n;
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n > 0) ? n : 1;
+}
+
+/**
+ * Query the processor topology from sysfs. Offline processors are skipped.
+ * Without topology information, each processor is its own core on a single
+ * package and node.
+ *   &returns: The topology, destroyed with '_topo_destroy'.
+ */
+
+_export
+struct _topo_t _topo_query(void)
+{
+	long n, id, pkg;
+	int node;
+	unsigned int i, k, cpu, ncpus;
+	long *core, *package;
+	struct _topo_t topo;
+
+	n = sysconf(_SC_NPROCESSORS_CONF);
+	ncpus = (n > 0) ? n : 1;
+
+	topo.cpu = malloc(ncpus * sizeof(struct _topocpu_t));
+	topo.ncpus = topo.ncores = topo.npackages = topo.nnodes = 0;
+
+	core = malloc(ncpus * sizeof(long));
+	package = malloc(ncpus * sizeof(long));
+
+	for(cpu = 0; cpu < ncpus; cpu++) {
+		if(topo_read(cpu, "online") == 0)
+			continue;
+
+		id = topo_read(cpu, "topology/core_id");
+		pkg = topo_read(cpu, "topology/physical_package_id");
+		node = topo_node(cpu);
+
+		if((id < 0) || (pkg < 0))
+			id = cpu, pkg = 0;
+
+		for(k = 0; k < topo.npackages; k++) {
+			if(package[k] == pkg)
+				break;
+		}
+
+		if(k == topo.npackages)
+			package[topo.npackages++] = pkg;
+
+		i = topo.ncpus++;
+		core[i] = id;
+		topo.cpu[i] = (struct _topocpu_t){ cpu, 0, k, (node >= 0) ? node : 0, false };
+
+		for(k = 0; k < i; k++) {
+			if((core[k] == id) && (topo.cpu[k].package == topo.cpu[i].package))
+				break;
+		}
+
+		if(k == i) {
+			topo.cpu[i].core = topo.ncores++;
+			topo.cpu[i].primary = true;
+		}
+		else
+			topo.cpu[i].core = topo.cpu[k].core;
+
+		if(topo.cpu[i].node >= topo.nnodes)
+			topo.nnodes = topo.cpu[i].node + 1;
+	}
+
+	free(core);
+	free(package);
+
+	return topo;
+}
+
+/**
+ * Destroy a topology.
+ *   @topo: The topology.
+ */
+
+_export
+void _topo_destroy(struct _topo_t *topo)
+{
+	free(topo->cpu);
+}
+
+
 /**
  * Detach a thread.
  *   @thread: The thread.
@@ -103,7 +341,12 @@ _mutex_t _mutex_init()
 	int err;
 	_mutex_t mutex;
 
-	err = pthread_mutex_init(&mutex, NULL);
+#if _lockprof
+	mutex.stat = NULL;
+	mutex.since = 0;
+#endif
+
+	err = pthread_mutex_init(MUTEX(&mutex), NULL);
 	if(err != 0)
 		throw("Failed create mutex. %s.", strerror(err));
 
@@ -111,7 +354,8 @@ _mutex_t _mutex_init()
 }
 
 /**
- * Destroy a mutex.
+ * Destroy a mutex. With lock profiling, its statistics are kept for the
+ * report.
  *   @mutex: The mutex.
  */
 
@@ -120,11 +364,31 @@ void _mutex_destroy(_mutex_t *mutex)
 {
 	int err;
 
-	err = pthread_mutex_destroy(mutex);
+#if _lockprof
+	if(mutex->stat != NULL)
+		lock_retire(mutex->stat);
+#endif
+
+	err = pthread_mutex_destroy(MUTEX(mutex));
 	if(err != 0)
 		throw("Failed destroy mutex. %s.", strerror(err));
 }
 
+/**
+ * Name a mutex for lock profiling. Without lock profiling, this does
+ * nothing.
+ *   @mutex: The mutex.
+ *   @name: The name, which must outlive the mutex.
+ */
+
+_export
+void _mutex_name(_mutex_t *mutex, const char *name)
+{
+#if _lockprof
+	lockstat(mutex)->name = name;
+#endif
+}
+
 
 /**
  * Failed to lock mutex.
@@ -136,9 +400,24 @@ void _mutex_lock(_mutex_t *mutex)
 {
 	int err;
 
+#if _lockprof
+	uint64_t start = 0;
+
+	err = pthread_mutex_trylock(MUTEX(mutex));
+	if(err == EBUSY) {
+		start = _clock_cycles();
+		err = pthread_mutex_lock(MUTEX(mutex));
+	}
+#else
 	err = pthread_mutex_lock(mutex);
+#endif
+
 	if(err != 0)
 		throw("Failed lock mutex. %s.", strerror(err));
+
+#if _lockprof
+	lock_acquire(mutex, start);
+#endif
 }
 
 /**
@@ -152,12 +431,20 @@ bool _mutex_trylock(_mutex_t *mutex)
 {
 	int err;
 
-	err = pthread_mutex_trylock(mutex);
-	if(err == EBUSY)
+	err = pthread_mutex_trylock(MUTEX(mutex));
+	if(err == EBUSY) {
+#if _lockprof
+		__atomic_add_fetch(&lockstat(mutex)->failed, 1, __ATOMIC_RELAXED);
+#endif
 		return false;
+	}
 	else if(err != 0)
 		throw("Failed lock mutex. %s.", strerror(err));
 
+#if _lockprof
+	lock_acquire(mutex, 0);
+#endif
+
 	return true;
 }
 
@@ -171,14 +458,18 @@ void _mutex_unlock(_mutex_t *mutex)
 {
 	int err;
 
-	err = pthread_mutex_unlock(mutex);
+#if _lockprof
+	lock_release(mutex);
+#endif
+
+	err = pthread_mutex_unlock(MUTEX(mutex));
 	if(err != 0)
 		throw("Failed unlock mutex. %s.", strerror(err));
 }
 
 
 /**
- * Initialize a condition variable.
+ * Initialize a condition variable. Timed waits use the monotonic clock.
  *   &returns: The condition variable.
  */
 
@@ -187,8 +478,13 @@ _cond_t _cond_init()
 {
 	int err;
 	_cond_t cond;
+	pthread_condattr_t attr;
 
-	err = pthread_cond_init(&cond, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	err = pthread_cond_init(&cond, &attr);
+	pthread_condattr_destroy(&attr);
 	if(err != 0)
 		throw("Failed create condition variable. %s.", strerror(err));
 
@@ -222,9 +518,56 @@ void _cond_wait(_cond_t *cond, _mutex_t *mutex)
 {
 	int err;
 
-	err = pthread_cond_wait(cond, mutex);
+#if _lockprof
+	lock_release(mutex);
+#endif
+
+	err = pthread_cond_wait(cond, MUTEX(mutex));
 	if(err != 0)
 		throw("Failed wait on condition variable. %s.", strerror(err));
+
+#if _lockprof
+	mutex->since = _clock_cycles();
+#endif
+}
+
+/**
+ * Wait on a condition variable with a timeout.
+ *   @cond: The condition variable.
+ *   @mutex: The mutex.
+ *   @timeout: The timeout in microseconds. Negative values wait indefinitely.
+ *   &returns: True if signaled, false on timeout.
+ */
+
+_export
+bool _cond_timedwait(_cond_t *cond, _mutex_t *mutex, int64_t timeout)
+{
+	int err;
+	struct timespec ts;
+
+	if(timeout < 0) {
+		_cond_wait(cond, mutex);
+		return true;
+	}
+
+	ts = deadline(CLOCK_MONOTONIC, timeout);
+
+#if _lockprof
+	lock_release(mutex);
+#endif
+
+	err = pthread_cond_timedwait(cond, MUTEX(mutex), &ts);
+
+#if _lockprof
+	mutex->since = _clock_cycles();
+#endif
+
+	if(err == ETIMEDOUT)
+		return false;
+	else if(err != 0)
+		throw("Failed wait on condition variable. %s.", strerror(err));
+
+	return true;
 }
 
 /**
@@ -242,6 +585,294 @@ void _cond_signal(_cond_t *cond)
 		throw("Failed signal on condition variable. %s.", strerror(err));
 }
 
+/**
+ * Signal all waiters on a condition variable.
+ *   @cond: The condition variable.
+ */
+
+_export
+void _cond_broadcast(_cond_t *cond)
+{
+	int err;
+
+	err = pthread_cond_broadcast(cond);
+	if(err != 0)
+		throw("Failed broadcast on condition variable. %s.", strerror(err));
+}
+
+
+/**
+ * Initialize a reader-writer lock.
+ *   &returns: The lock.
+ */
+
+_export
+_rwlock_t _rwlock_init()
+{
+	int err;
+	_rwlock_t rwlock;
+
+	err = pthread_rwlock_init(&rwlock, NULL);
+	if(err != 0)
+		throw("Failed create reader-writer lock. %s.", strerror(err));
+
+	return rwlock;
+}
+
+/**
+ * Destroy a reader-writer lock.
+ *   @rwlock: The lock.
+ */
+
+_export
+void _rwlock_destroy(_rwlock_t *rwlock)
+{
+	int err;
+
+	err = pthread_rwlock_destroy(rwlock);
+	if(err != 0)
+		throw("Failed destroy reader-writer lock. %s.", strerror(err));
+}
+
+
+/**
+ * Lock a reader-writer lock for reading.
+ *   @rwlock: The lock.
+ */
+
+_export
+void _rwlock_rdlock(_rwlock_t *rwlock)
+{
+	int err;
+
+	err = pthread_rwlock_rdlock(rwlock);
+	if(err != 0)
+		throw("Failed lock reader-writer lock. %s.", strerror(err));
+}
+
+/**
+ * Attempt to lock a reader-writer lock for reading.
+ *   @rwlock: The lock.
+ *   &returns: True if locked held, false otherwise.
+ */
+
+_export
+bool _rwlock_tryrdlock(_rwlock_t *rwlock)
+{
+	int err;
+
+	err = pthread_rwlock_tryrdlock(rwlock);
+	if(err == EBUSY)
+		return false;
+	else if(err != 0)
+		throw("Failed lock reader-writer lock. %s.", strerror(err));
+
+	return true;
+}
+
+/**
+ * Lock a reader-writer lock for writing.
+ *   @rwlock: The lock.
+ */
+
+_export
+void _rwlock_wrlock(_rwlock_t *rwlock)
+{
+	int err;
+
+	err = pthread_rwlock_wrlock(rwlock);
+	if(err != 0)
+		throw("Failed lock reader-writer lock. %s.", strerror(err));
+}
+
+/**
+ * Attempt to lock a reader-writer lock for writing.
+ *   @rwlock: The lock.
+ *   &returns: True if locked held, false otherwise.
+ */
+
+_export
+bool _rwlock_trywrlock(_rwlock_t *rwlock)
+{
+	int err;
+
+	err = pthread_rwlock_trywrlock(rwlock);
+	if(err == EBUSY)
+		return false;
+	else if(err != 0)
+		throw("Failed lock reader-writer lock. %s.", strerror(err));
+
+	return true;
+}
+
+/**
+ * Unlock a reader-writer lock.
+ *   @rwlock: The lock.
+ */
+
+_export
+void _rwlock_unlock(_rwlock_t *rwlock)
+{
+	int err;
+
+	err = pthread_rwlock_unlock(rwlock);
+	if(err != 0)
+		throw("Failed unlock reader-writer lock. %s.", strerror(err));
+}
+
+
+/**
+ * Slow path for acquiring an adaptive lock. The lock is polled for a short
+ * while, since most critical sections are brief, and then marked contended
+ * while sleeping on the kernel futex.
+ *   @lock: The lock.
+ */
+
+_export
+void _lock_wait(_lock_t *lock)
+{
+	unsigned int i;
+	uint32_t state;
+
+	for(i = 0; i < LOCK_SPIN; i++) {
+		state = _atomic_load(&lock->state, _ATOMIC_RELAXED);
+		if(state == 0) {
+			if(_atomic_cas_weak(&lock->state, &state, 1, _ATOMIC_ACQUIRE, _ATOMIC_RELAXED))
+				return;
+		}
+		else if(state == 2)
+			break;
+
+		relax();
+	}
+
+	while(_atomic_xchg(&lock->state, 2, _ATOMIC_ACQUIRE) != 0) {
+#ifdef __linux__
+		syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+#else
+		sched_yield();
+#endif
+	}
+}
+
+/**
+ * Wake a waiter on an adaptive lock.
+ *   @lock: The lock.
+ */
+
+_export
+void _lock_wake(_lock_t *lock)
+{
+#ifdef __linux__
+	syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+}
+
+
+/**
+ * Initialize a semaphore.
+ *   @value: The initial count.
+ *   &returns: The semaphore.
+ */
+
+_export
+_sem_t _sem_init(unsigned int value)
+{
+	_sem_t sem;
+
+	if(sem_init(&sem, 0, value) < 0)
+		throw("Failed create semaphore. %s.", strerror(errno));
+
+	return sem;
+}
+
+/**
+ * Destroy a semaphore.
+ *   @sem: The semaphore.
+ */
+
+_export
+void _sem_destroy(_sem_t *sem)
+{
+	if(sem_destroy(sem) < 0)
+		throw("Failed destroy semaphore. %s.", strerror(errno));
+}
+
+
+/**
+ * Wait on a semaphore, decrementing its count.
+ *   @sem: The semaphore.
+ */
+
+_export
+void _sem_wait(_sem_t *sem)
+{
+	while(sem_wait(sem) < 0) {
+		if(errno != EINTR)
+			throw("Failed wait on semaphore. %s.", strerror(errno));
+	}
+}
+
+/**
+ * Attempt to decrement a semaphore without waiting.
+ *   @sem: The semaphore.
+ *   &returns: True if decremented, false otherwise.
+ */
+
+_export
+bool _sem_trywait(_sem_t *sem)
+{
+	while(sem_trywait(sem) < 0) {
+		if(errno == EAGAIN)
+			return false;
+		else if(errno != EINTR)
+			throw("Failed wait on semaphore. %s.", strerror(errno));
+	}
+
+	return true;
+}
+
+/**
+ * Wait on a semaphore with a timeout.
+ *   @sem: The semaphore.
+ *   @timeout: The timeout in microseconds. Negative values wait indefinitely.
+ *   &returns: True if decremented, false on timeout.
+ */
+
+_export
+bool _sem_timedwait(_sem_t *sem, int64_t timeout)
+{
+	struct timespec ts;
+
+	if(timeout < 0) {
+		_sem_wait(sem);
+		return true;
+	}
+
+	ts = deadline(CLOCK_REALTIME, timeout);
+
+	while(sem_timedwait(sem, &ts) < 0) {
+		if(errno == ETIMEDOUT)
+			return false;
+		else if(errno != EINTR)
+			throw("Failed wait on semaphore. %s.", strerror(errno));
+	}
+
+	return true;
+}
+
+/**
+ * Post to a semaphore, incrementing its count.
+ *   @sem: The semaphore.
+ */
+
+_export
+void _sem_post(_sem_t *sem)
+{
+	if(sem_post(sem) < 0)
+		throw("Failed post to semaphore. %s.", strerror(errno));
+}
+
 
 /**
  * Allocate a thread-specific variable.
@@ -312,13 +943,12 @@ struct _task_t _task_init(void *(*func)(void *), void *arg)
 	struct info_t *info;
 	struct _task_t task;
 
-	if(pipe(task.pipe) < 0)
-		fatal("Failed to create pipe. %s.", strerror(errno));
+	task.event = _event_init();
 
 	info = malloc(sizeof(struct info_t));
-	*info = (struct info_t){ task.pipe[0], func, arg };
+	*info = (struct info_t){ task.event.fd, func, arg };
 
-	task.fd = task.pipe[0];
+	task.fd = task.event.fd;
 	task.thread = _thread_new(task_proc, info);
 
 	return task;
@@ -333,17 +963,61 @@ struct _task_t _task_init(void *(*func)(void *), void *arg)
 _export
 void *_task_destroy(struct _task_t *task)
 {
-	int err;
 	void *ret;
-	uint8_t one = 1;
 
-	err = write(task->pipe[1], &one, 1);
-	if(err <= 0)
-		fatal("Failed to synchronize task. %s.", err ? strerror(errno) : "Failed to write");
+	_event_signal(&task->event, 1);
 
 	ret = _thread_join(task->thread);
-	close(task->pipe[0]);
-	close(task->pipe[1]);
+	_event_destroy(&task->event);
+
+	return ret;
+}
+
+/**
+ * Wait for termination of a task to be requested. The request is not
+ * consumed, so later waits return immediately. The 'fd' member may instead
+ * be placed in a poll set with '_poll_in_e', but it is an event descriptor
+ * and must not be read directly.
+ *   @task: The task.
+ *   @timeout: The timeout in microseconds. Negative values wait indefinitely.
+ *   &returns: True if termination was requested, false on timeout.
+ */
+
+_export
+bool _task_wait(struct _task_t *task, int64_t timeout)
+{
+	return _poll1(task->fd, _poll_in_e, timeout) != 0;
+}
+
+/**
+ * Thread processing function.
+ *   @arg: The start argument.
+ *   &returns: The thread return.
+ */
+
+static void *thread_proc(void *arg)
+{
+	void *ret;
+	struct start_t start;
+
+	start = *(struct start_t *)arg;
+	free(arg);
+
+	if(start.name[0] != '\0')
+		pthread_setname_np(pthread_self(), start.name);
+
+#ifdef __linux__
+	if((start.node >= 0) && (start.node < TOPO_NODES)) {
+		unsigned long mask[TOPO_NODES / (8 * sizeof(unsigned long))] = { 0 };
+
+		mask[start.node / (8 * sizeof(unsigned long))] |= 1ul << (start.node % (8 * sizeof(unsigned long)));
+		syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, TOPO_NODES + 1);
+	}
+#endif
+
+	_res_enter();
+	ret = start.func(start.arg);
+	_res_leave();
 
 	return ret;
 }
@@ -363,3 +1037,299 @@ static void *task_proc(void *arg)
 
 	return info.func(info.arg);
 }
+
+/**
+ * Compute an absolute deadline.
+ *   @clock: The clock.
+ *   @timeout: The timeout in microseconds.
+ *   &returns: The deadline.
+ */
+
+static struct timespec deadline(clockid_t clock, int64_t timeout)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	ts.tv_sec += timeout / 1000000;
+	ts.tv_nsec += (timeout % 1000000) * 1000;
+	if(ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	return ts;
+}
+
+/**
+ * Hint to the processor that the thread is spinning.
+ */
+
+static inline void relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ volatile("yield" ::: "memory");
+#endif
+}
+
+#if _lockprof
+/**
+ * Copy the statistics of all live and destroyed mutexes.
+ *   @cnt: Out. The number of statistics.
+ *   &returns: The array, freed with 'free'.
+ */
+
+struct _lockstat_t *_lockstat_snapshot(unsigned int *cnt)
+{
+	unsigned int i, n = 0, max = 64;
+	struct _lockstat_t *list, *stat, *head[2];
+
+	list = malloc(max * sizeof(struct _lockstat_t));
+
+	_lock_acquire(&registry);
+
+	head[0] = live;
+	head[1] = retired;
+
+	for(i = 0; i < 2; i++) {
+		for(stat = head[i]; stat != NULL; stat = stat->next) {
+			if(n == max)
+				list = realloc(list, (max *= 2) * sizeof(struct _lockstat_t));
+
+			list[n++] = *stat;
+		}
+	}
+
+	_lock_release(&registry);
+
+	*cnt = n;
+
+	return list;
+}
+
+/**
+ * Retrieve the statistics of a mutex, allocating them on first use.
+ *   @mutex: The mutex.
+ *   &returns: The statistics.
+ */
+
+static struct _lockstat_t *lockstat(_mutex_t *mutex)
+{
+	struct _lockstat_t *stat;
+
+	stat = __atomic_load_n(&mutex->stat, __ATOMIC_ACQUIRE);
+	if(stat != NULL)
+		return stat;
+
+	_lock_acquire(&registry);
+
+	stat = mutex->stat;
+	if(stat == NULL) {
+		stat = calloc(1, sizeof(struct _lockstat_t));
+		stat->addr = mutex;
+		stat->next = live;
+		if(live != NULL)
+			live->prev = stat;
+
+		live = stat;
+		__atomic_store_n(&mutex->stat, stat, __ATOMIC_RELEASE);
+	}
+
+	_lock_release(&registry);
+
+	return stat;
+}
+
+/**
+ * Retire the statistics of a destroyed mutex, merging them with earlier
+ * statistics of the same name.
+ *   @stat: The statistics.
+ */
+
+static void lock_retire(struct _lockstat_t *stat)
+{
+	unsigned int i;
+	struct _lockstat_t *iter;
+
+	_lock_acquire(&registry);
+
+	if(stat->prev != NULL)
+		stat->prev->next = stat->next;
+	else
+		live = stat->next;
+
+	if(stat->next != NULL)
+		stat->next->prev = stat->prev;
+
+	for(iter = retired; iter != NULL; iter = iter->next) {
+		if((iter->name == stat->name) || ((iter->name != NULL) && (stat->name != NULL) && (strcmp(iter->name, stat->name) == 0)))
+			break;
+	}
+
+	if(iter != NULL) {
+		iter->acquires += stat->acquires;
+		iter->contended += stat->contended;
+		iter->failed += stat->failed;
+		iter->wait += stat->wait;
+		iter->hold += stat->hold;
+		iter->maxwait = (stat->maxwait > iter->maxwait) ? stat->maxwait : iter->maxwait;
+		iter->maxhold = (stat->maxhold > iter->maxhold) ? stat->maxhold : iter->maxhold;
+
+		for(i = 0; i < LOCKPROF_BINS; i++)
+			iter->hist[i] += stat->hist[i];
+
+		free(stat);
+	}
+	else {
+		stat->addr = NULL;
+		stat->prev = NULL;
+		stat->next = retired;
+		retired = stat;
+	}
+
+	_lock_release(&registry);
+}
+
+/**
+ * Account the acquisition of a mutex.
+ *   @mutex: The mutex, now held.
+ *   @start: The cycle count when the wait started, or zero if uncontended.
+ */
+
+static void lock_acquire(_mutex_t *mutex, uint64_t start)
+{
+	unsigned int bin;
+	uint64_t now, ns;
+	struct _lockstat_t *stat;
+
+	now = _clock_cycles();
+	stat = lockstat(mutex);
+	stat->acquires++;
+
+	if(start != 0) {
+		ns = _cycles_ns(now - start);
+		bin = (ns > 0) ? (64 - __builtin_clzll(ns)) : 0;
+
+		stat->contended++;
+		stat->wait += ns;
+		stat->hist[(bin < LOCKPROF_BINS) ? bin : (LOCKPROF_BINS - 1)]++;
+		if(ns > stat->maxwait)
+			stat->maxwait = ns;
+	}
+
+	mutex->since = now;
+}
+
+/**
+ * Account the release of a mutex.
+ *   @mutex: The mutex, still held.
+ */
+
+static void lock_release(_mutex_t *mutex)
+{
+	uint64_t ns;
+	struct _lockstat_t *stat;
+
+	stat = lockstat(mutex);
+	ns = _cycles_ns(_clock_cycles() - mutex->since);
+
+	stat->hold += ns;
+	if(ns > stat->maxhold)
+		stat->maxhold = ns;
+}
+#endif
+
+/**
+ * Apply the processor set of thread attributes.
+ *   @pattr: The pthread attributes.
+ *   @attr: The thread attributes.
+ */
+
+static void attr_affinity(pthread_attr_t *pattr, const struct _thrattr_t *attr)
+{
+#ifdef __linux__
+	unsigned int i;
+	cpu_set_t set;
+	struct _topo_t topo;
+
+	CPU_ZERO(&set);
+
+	for(i = 0; i < attr->ncpus; i++) {
+		if(attr->cpus[i] < CPU_SETSIZE)
+			CPU_SET(attr->cpus[i], &set);
+	}
+
+	if((attr->ncpus == 0) && (attr->node >= 0)) {
+		topo = _topo_query();
+
+		for(i = 0; i < topo.ncpus; i++) {
+			if((topo.cpu[i].node == (unsigned int)attr->node) && (topo.cpu[i].id < CPU_SETSIZE))
+				CPU_SET(topo.cpu[i].id, &set);
+		}
+
+		_topo_destroy(&topo);
+	}
+
+	if(CPU_COUNT(&set) > 0)
+		pthread_attr_setaffinity_np(pattr, sizeof(cpu_set_t), &set);
+#endif
+}
+
+/**
+ * Read a number from the sysfs directory of a processor.
+ *   @cpu: The processor.
+ *   @file: The file relative to the processor directory.
+ *   &returns: The number, or negative if unavailable.
+ */
+
+static long topo_read(unsigned int cpu, const char *file)
+{
+	FILE *fp;
+	long val;
+	char path[256];
+
+	snprintf(path, sizeof(path), TOPO_SYS "/cpu%u/%s", cpu, file);
+
+	fp = fopen(path, "r");
+	if(fp == NULL)
+		return -1;
+
+	if(fscanf(fp, "%ld", &val) != 1)
+		val = -1;
+
+	fclose(fp);
+
+	return val;
+}
+
+/**
+ * Find the NUMA node of a processor from its 'node' link in sysfs.
+ *   @cpu: The processor.
+ *   &returns: The node, or negative if unavailable.
+ */
+
+static int topo_node(unsigned int cpu)
+{
+	DIR *dir;
+	int node = -1;
+	char path[256];
+	struct dirent *entry;
+
+	snprintf(path, sizeof(path), TOPO_SYS "/cpu%u", cpu);
+
+	dir = opendir(path);
+	if(dir == NULL)
+		return -1;
+
+	while((entry = readdir(dir)) != NULL) {
+		if((strncmp(entry->d_name, "node", 4) == 0) && (entry->d_name[4] >= '0') && (entry->d_name[4] <= '9')) {
+			node = atoi(entry->d_name + 4);
+			break;
+		}
+	}
+
+	closedir(dir);
+
+	return node;
+}
@@ -7,9 +7,20 @@
 
 void _thread_once(_once_t *once, void (*func)(void));
 _thread_t _thread_new(void *(*func)(void *), void *arg);
+_thread_t _thread_new_attr(void *(*func)(void *), void *arg, const struct _thrattr_t *attr);
+struct _thrattr_t _thrattr_init(void);
+void _thread_yield(void);
+unsigned int _thread_ncpus(void);
 void _thread_detach(_thread_t thread);
 void *_thread_join(_thread_t thread);
 
+/*
+ * topology function declarations
+ */
+
+struct _topo_t _topo_query(void);
+void _topo_destroy(struct _topo_t *topo);
+
 /*
  * mutex function declarations
  */
@@ -17,6 +28,8 @@ void *_thread_join(_thread_t thread);
 _mutex_t _mutex_init();
 void _mutex_destroy(_mutex_t *mutex);
 
+void _mutex_name(_mutex_t *mutex, const char *name);
+
 void _mutex_lock(_mutex_t *mutex);
 bool _mutex_trylock(_mutex_t *mutex);
 void _mutex_unlock(_mutex_t *mutex);
@@ -29,7 +42,41 @@ _cond_t _cond_init();
 void _cond_destroy(_cond_t *cond);
 
 void _cond_wait(_cond_t *cond, _mutex_t *mutex);
+bool _cond_timedwait(_cond_t *cond, _mutex_t *mutex, int64_t timeout);
 void _cond_signal(_cond_t *cond);
+void _cond_broadcast(_cond_t *cond);
+
+/*
+ * reader-writer lock function declarations
+ */
+
+_rwlock_t _rwlock_init();
+void _rwlock_destroy(_rwlock_t *rwlock);
+
+void _rwlock_rdlock(_rwlock_t *rwlock);
+bool _rwlock_tryrdlock(_rwlock_t *rwlock);
+void _rwlock_wrlock(_rwlock_t *rwlock);
+bool _rwlock_trywrlock(_rwlock_t *rwlock);
+void _rwlock_unlock(_rwlock_t *rwlock);
+
+/*
+ * adaptive lock function declarations
+ */
+
+void _lock_wait(_lock_t *lock);
+void _lock_wake(_lock_t *lock);
+
+/*
+ * semaphore function declarations
+ */
+
+_sem_t _sem_init(unsigned int value);
+void _sem_destroy(_sem_t *sem);
+
+void _sem_wait(_sem_t *sem);
+bool _sem_trywait(_sem_t *sem);
+bool _sem_timedwait(_sem_t *sem, int64_t timeout);
+void _sem_post(_sem_t *sem);
 
 /*
  * thread-local function declarations
@@ -47,11 +94,88 @@ void _specific_set(_specific_t specific, void *ptr);
 
 struct _task_t _task_init(void *(*func)(void *), void *arg);
 void *_task_destroy(struct _task_t *task);
+bool _task_wait(struct _task_t *task, int64_t timeout);
 
 /*
  * initializer definitions
  */
 
-#define _MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#if _lockprof
+#	define _MUTEX_INIT { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+#else
+#	define _MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#endif
+#define _RWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+#define _LOCK_INIT { 0 }
+
+/*
+ * atomic definitions
+ */
+
+#define _ATOMIC_RELAXED __ATOMIC_RELAXED
+#define _ATOMIC_ACQUIRE __ATOMIC_ACQUIRE
+#define _ATOMIC_RELEASE __ATOMIC_RELEASE
+#define _ATOMIC_ACQ_REL __ATOMIC_ACQ_REL
+#define _ATOMIC_SEQ_CST __ATOMIC_SEQ_CST
+
+#define _atomic_load(ptr, order) __atomic_load_n(ptr, order)
+#define _atomic_store(ptr, val, order) __atomic_store_n(ptr, val, order)
+#define _atomic_xchg(ptr, val, order) __atomic_exchange_n(ptr, val, order)
+#define _atomic_cas(ptr, expect, val, order, fail) __atomic_compare_exchange_n(ptr, expect, val, false, order, fail)
+#define _atomic_cas_weak(ptr, expect, val, order, fail) __atomic_compare_exchange_n(ptr, expect, val, true, order, fail)
+#define _atomic_add(ptr, val, order) __atomic_fetch_add(ptr, val, order)
+#define _atomic_sub(ptr, val, order) __atomic_fetch_sub(ptr, val, order)
+#define _atomic_and(ptr, val, order) __atomic_fetch_and(ptr, val, order)
+#define _atomic_or(ptr, val, order) __atomic_fetch_or(ptr, val, order)
+#define _atomic_fence(order) __atomic_thread_fence(order)
+
+
+/**
+ * Initialize an adaptive lock.
+ *   &returns: The lock.
+ */
+
+static inline _lock_t _lock_init(void)
+{
+	return (_lock_t){ 0 };
+}
+
+/**
+ * Acquire an adaptive lock. The uncontended path is a single exchange;
+ * otherwise, the lock spins briefly before sleeping.
+ *   @lock: The lock.
+ */
+
+static inline void _lock_acquire(_lock_t *lock)
+{
+	uint32_t expect = 0;
+
+	if(!_atomic_cas_weak(&lock->state, &expect, 1, _ATOMIC_ACQUIRE, _ATOMIC_RELAXED))
+		_lock_wait(lock);
+}
+
+/**
+ * Attempt to acquire an adaptive lock without waiting.
+ *   @lock: The lock.
+ *   &returns: True if acquired, false otherwise.
+ */
+
+static inline bool _lock_tryacquire(_lock_t *lock)
+{
+	uint32_t expect = 0;
+
+	return _atomic_cas(&lock->state, &expect, 1, _ATOMIC_ACQUIRE, _ATOMIC_RELAXED);
+}
+
+/**
+ * Release an adaptive lock, waking a waiter if any.
+ *   @lock: The lock.
+ */
+
+static inline void _lock_release(_lock_t *lock)
+{
+	if(_atomic_xchg(&lock->state, 0, _ATOMIC_RELEASE) == 2)
+		_lock_wake(lock);
+}
 
 #endif
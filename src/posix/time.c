@@ -5,8 +5,62 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "thread.h"
 #include "../try.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#	include <cpuid.h>
+#endif
+
+
+/*
+ * calibration definitions
+ */
+
+#define CALIB_NS	2000000
+
+/*
+ * global variables
+ */
+
+_export bool _clock_tsc = false;
+
+/*
+ * local function declarations
+ */
+
+static void calibrate(void);
+
+/*
+ * local variables
+ */
+
+static _once_t once = _ONCE_INIT;
+static uint64_t freq = 1000000000;
+static uint64_t mult = (uint64_t)1 << 32;
+
+
+/**
+ * Initialize the clocks, detecting an invariant TSC. Calibration is left
+ * to the first cycle conversion, so processes that never use it do not pay
+ * for it.
+ */
+
+void _clock_init(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+
+	if(!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 27)))
+		return;
+
+	if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+		return;
+
+	_clock_tsc = true;
+#endif
+}
+
 
 /**
  * Retrieve the time in seconds.
@@ -97,3 +151,127 @@ int64_t _clock_monotonic()
 
 	return 1000000000 * (int64_t)ts.tv_sec + (int64_t)ts.tv_nsec;
 }
+
+
+/**
+ * Retrieve the coarse realtime clock time. The coarse clocks are read from
+ * the vDSO without a system call at the resolution of the scheduler tick and
+ * never throw.
+ *   &returns: The time in nanoseconds.
+ */
+
+_export
+int64_t _clock_realtime_coarse(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_REALTIME_COARSE
+	clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+
+	return 1000000000 * (int64_t)ts.tv_sec + (int64_t)ts.tv_nsec;
+}
+
+/**
+ * Retrieve the coarse monotonic clock time.
+ *   &returns: The time in nanoseconds.
+ */
+
+_export
+int64_t _clock_monotonic_coarse(void)
+{
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+	return 1000000000 * (int64_t)ts.tv_sec + (int64_t)ts.tv_nsec;
+}
+
+
+/**
+ * Retrieve the fallback cycle counter, the monotonic clock in nanoseconds.
+ * This never throws.
+ *   &returns: The tick count.
+ */
+
+_export
+uint64_t _clock_ticks(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return 1000000000 * (uint64_t)ts.tv_sec + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Retrieve the calibrated cycle counter frequency.
+ *   &returns: The number of cycles per second.
+ */
+
+_export
+uint64_t _cycles_freq(void)
+{
+	_thread_once(&once, calibrate);
+
+	return freq;
+}
+
+/**
+ * Convert a cycle count difference into nanoseconds.
+ *   @cycles: The number of cycles.
+ *   &returns: The number of nanoseconds.
+ */
+
+_export
+int64_t _cycles_ns(uint64_t cycles)
+{
+	_thread_once(&once, calibrate);
+
+#ifdef __SIZEOF_INT128__
+	return (int64_t)(((unsigned __int128)cycles * mult) >> 32);
+#else
+	uint64_t hi = cycles >> 32, lo = cycles & 0xFFFFFFFF;
+
+	return (int64_t)(hi * mult + lo * (mult >> 32) + ((lo * (mult & 0xFFFFFFFF)) >> 32));
+#endif
+}
+
+
+/**
+ * Calibrate the cycle counter against the monotonic clock. The calibration
+ * is scaled so the cycle count fits in 32 bits, keeping the arithmetic in 64
+ * bits.
+ */
+
+static void calibrate(void)
+{
+	int64_t ns;
+	uint64_t cycles;
+
+	if(!_clock_tsc)
+		return;
+
+	ns = _clock_monotonic();
+	cycles = _clock_cycles();
+
+	while(_clock_monotonic() - ns < CALIB_NS)
+		;
+
+	cycles = _clock_cycles() - cycles;
+	ns = _clock_monotonic() - ns;
+
+	while(cycles >= ((uint64_t)1 << 32)) {
+		cycles >>= 1;
+		ns >>= 1;
+	}
+
+	freq = (cycles / ns) * 1000000000 + (cycles % ns) * 1000000000 / ns;
+	mult = ((uint64_t)ns << 32) / cycles;
+}
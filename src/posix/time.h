@@ -1,10 +1,18 @@
 #ifndef POSIX_SYS_H
 #define POSIX_SYS_H
 
+/*
+ * cycle counter variables
+ */
+
+extern bool _clock_tsc;
+
 /*
  * time function declarations
  */
 
+void _clock_init(void);
+
 int64_t _time(void);
 int64_t _utime(void);
 
@@ -14,4 +22,34 @@ void _usleep(uint64_t usec);
 int64_t _clock_realtime();
 int64_t _clock_monotonic();
 
+int64_t _clock_realtime_coarse(void);
+int64_t _clock_monotonic_coarse(void);
+
+uint64_t _clock_ticks(void);
+uint64_t _cycles_freq(void);
+int64_t _cycles_ns(uint64_t cycles);
+
+
+/**
+ * Read the cycle counter. When the processor provides an invariant TSC, this
+ * is a serialized 'rdtscp' read; otherwise, it falls back to the monotonic
+ * clock in nanoseconds. Use '_cycles_ns' to convert differences.
+ *   &returns: The cycle count.
+ */
+
+static inline uint64_t _clock_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if(_clock_tsc) {
+		uint32_t lo, hi, aux;
+
+		__asm__ volatile("rdtscp\n\tlfence" : "=a"(lo), "=d"(hi), "=c"(aux) : : "memory");
+
+		return ((uint64_t)hi << 32) | lo;
+	}
+#endif
+
+	return _clock_ticks();
+}
+
 #endif
@@ -1,5 +1,7 @@
+#define _GNU_SOURCE
 #include "../common.h"
 #include "trace.h"
+#include <dlfcn.h>
 #include <execinfo.h>
 
 
@@ -13,3 +15,26 @@ void _backtrace(void **buf, unsigned int n)
 {
 	backtrace(buf, n-1);
 }
+
+/**
+ * Write the symbol name of an address. Unnamed addresses are written as
+ * an offset into their module, or as the raw address if unknown.
+ *   @buf: The output buffer.
+ *   @len: The buffer length.
+ *   @addr: The address.
+ */
+
+void _symbol(char *buf, size_t len, void *addr)
+{
+	Dl_info info;
+	const char *file;
+
+	if(!dladdr(addr, &info) || (info.dli_fname == NULL))
+		snprintf(buf, len, "%p", addr);
+	else if(info.dli_sname != NULL)
+		snprintf(buf, len, "%s", info.dli_sname);
+	else {
+		file = strrchr(info.dli_fname, '/');
+		snprintf(buf, len, "%s+0x%lx", file ? file + 1 : info.dli_fname, (unsigned long)((uintptr_t)addr - (uintptr_t)info.dli_fbase));
+	}
+}
@@ -6,5 +6,6 @@
  */
 
 void _backtrace(void **buf, unsigned int n);
+void _symbol(char *buf, size_t len, void *addr);
 
 #endif
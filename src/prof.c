@@ -0,0 +1,418 @@
+#include "common.h"
+#include "prof.h"
+#include <math.h>
+#include "io/input.h"
+#include "io/output.h"
+#include "io/print.h"
+#include "mem.h"
+#include "posix/inc.h"
+#include "posix/trace.h"
+#include "res.h"
+
+
+/*
+ * profiler definitions
+ */
+
+#define PROF_DEPTH	32
+#define PROF_BITS	14
+#define PROF_BUCKETS	(1 << PROF_BITS)
+#define PROF_STRIPES	64
+
+/**
+ * Sample structure.
+ *   @next: The next sample in the bucket.
+ *   @ptr: The sampled memory.
+ *   @nbytes: The number of bytes.
+ *   @depth: The trace depth.
+ *   @trace: The allocation trace, innermost first.
+ */
+
+struct sample_t {
+	struct sample_t *next;
+
+	void *ptr;
+	size_t nbytes;
+
+	unsigned int depth;
+	void *trace[PROF_DEPTH];
+};
+
+
+/*
+ * local function declarations
+ */
+
+static unsigned int bucket(void *ptr);
+static int64_t interval(struct _res_thread_t *thread, size_t rate);
+
+static struct sample_t *snapshot(size_t *cnt);
+static int sample_cmp(const void *left, const void *right);
+static bool sample_same(const struct sample_t *left, const struct sample_t *right);
+
+
+/*
+ * global variables
+ */
+
+_export size_t _prof_rate = 0;
+_export size_t _prof_live = 0;
+
+/*
+ * local variables
+ */
+
+static _mutex_t locks[PROF_STRIPES];
+static struct sample_t *table[PROF_BUCKETS];
+
+
+/**
+ * Initialize the profiler.
+ */
+
+void _prof_init(void)
+{
+	unsigned int i;
+
+	for(i = 0; i < PROF_STRIPES; i++) {
+		locks[i] = _mutex_init();
+		_mutex_name(&locks[i], "prof");
+	}
+}
+
+/**
+ * Destroy the profiler.
+ */
+
+void _prof_destroy(void)
+{
+	unsigned int i;
+
+	prof_stop();
+
+	for(i = 0; i < PROF_STRIPES; i++)
+		_mutex_destroy(&locks[i]);
+}
+
+
+/**
+ * Start heap profiling. On average, one allocation is sampled every 'rate'
+ * bytes, recording its backtrace until it is freed. Allocations carved
+ * from arena scopes are not sampled.
+ *   @rate: The mean number of bytes between samples.
+ */
+
+_export
+void prof_start(size_t rate)
+{
+	__atomic_store_n(&_prof_rate, (rate > 0) ? rate : 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Stop heap profiling, discarding all live samples.
+ */
+
+_export
+void prof_stop(void)
+{
+	unsigned int i, k;
+	struct sample_t *sample;
+
+	__atomic_store_n(&_prof_rate, 0, __ATOMIC_RELAXED);
+
+	for(i = 0; i < PROF_STRIPES; i++) {
+		_mutex_lock(&locks[i]);
+
+		for(k = i; k < PROF_BUCKETS; k += PROF_STRIPES) {
+			while(table[k] != NULL) {
+				sample = table[k];
+				__atomic_store_n(&table[k], sample->next, __ATOMIC_RELAXED);
+				__atomic_sub_fetch(&_prof_live, 1, __ATOMIC_RELAXED);
+				_slab_free(sample);
+			}
+		}
+
+		_mutex_unlock(&locks[i]);
+	}
+}
+
+/**
+ * Write the live heap profile. Samples with the same backtrace are merged.
+ * The pprof format carries the raw samples and the sampling rate, leaving
+ * pprof to scale them; the folded format is scaled to estimated bytes.
+ *   @output: The output.
+ *   @format: The format.
+ */
+
+_export
+void prof_write(struct io_output_t output, enum prof_format_e format)
+{
+	size_t i, n, cnt, nbytes;
+	double est, rate;
+	unsigned int k;
+	struct sample_t *list;
+	char sym[256];
+
+	rate = __atomic_load_n(&_prof_rate, __ATOMIC_RELAXED);
+	if(rate == 0)
+		rate = 1;
+
+	list = snapshot(&cnt);
+
+	if(format == prof_pprof_e) {
+		for(i = nbytes = 0; i < cnt; i++)
+			nbytes += list[i].nbytes;
+
+		io_print_str(output, "heap profile: ");
+		io_format_uint64(output, cnt, 10, 6, false, ' ');
+		io_print_str(output, ": ");
+		io_format_uint64(output, nbytes, 10, 8, false, ' ');
+		io_print_str(output, " [");
+		io_format_uint64(output, cnt, 10, 6, false, ' ');
+		io_print_str(output, ": ");
+		io_format_uint64(output, nbytes, 10, 8, false, ' ');
+		io_print_str(output, "] @ heap_v2/");
+		io_format_uint64(output, (uint64_t)rate, 10, 0, false, ' ');
+		io_print_char(output, '\n');
+	}
+
+	for(i = 0; i < cnt; i = n) {
+		est = 0.0;
+		nbytes = 0;
+
+		for(n = i; (n < cnt) && sample_same(&list[i], &list[n]); n++) {
+			nbytes += list[n].nbytes;
+			est += list[n].nbytes / (1.0 - exp(-(double)list[n].nbytes / rate));
+		}
+
+		if(format == prof_pprof_e) {
+			io_format_uint64(output, n - i, 10, 6, false, ' ');
+			io_print_str(output, ": ");
+			io_format_uint64(output, nbytes, 10, 8, false, ' ');
+			io_print_str(output, " [");
+			io_format_uint64(output, n - i, 10, 6, false, ' ');
+			io_print_str(output, ": ");
+			io_format_uint64(output, nbytes, 10, 8, false, ' ');
+			io_print_str(output, "] @");
+
+			for(k = 0; k < list[i].depth; k++) {
+				io_print_str(output, " 0x");
+				io_format_uint64(output, (uintptr_t)list[i].trace[k], 16, 0, false, ' ');
+			}
+		}
+		else {
+			for(k = list[i].depth; k-- > 0; ) {
+				_symbol(sym, sizeof(sym), list[i].trace[k]);
+				io_print_str(output, sym);
+				io_print_char(output, (k > 0) ? ';' : ' ');
+			}
+
+			io_format_uint64(output, (uint64_t)est, 10, 0, false, ' ');
+		}
+
+		io_print_char(output, '\n');
+	}
+
+	_slab_free(list);
+
+	if((format == prof_pprof_e) && _exists("/proc/self/maps")) {
+		struct io_input_t input;
+		uint8_t buf[4096];
+
+		io_print_str(output, "\nMAPPED_LIBRARIES:\n");
+
+		input = io_input_open("/proc/self/maps", 0);
+
+		while((n = io_input_read(input, buf, sizeof(buf))) > 0)
+			io_output_full(output, buf, n);
+
+		io_input_close(input);
+	}
+}
+
+
+/**
+ * Count allocated bytes toward the next sample, sampling the allocation if
+ * the count runs out.
+ *   @ptr: The allocated memory.
+ *   @nbytes: The number of bytes.
+ */
+
+void _prof_count(void *ptr, size_t nbytes)
+{
+	unsigned int idx;
+	struct res_info_t *info;
+	struct _res_thread_t *thread;
+	struct sample_t *sample;
+	size_t rate;
+
+	info = res_info();
+	rate = __atomic_load_n(&_prof_rate, __ATOMIC_RELAXED);
+	if((info == NULL) || (rate == 0))
+		return;
+
+	thread = info->thread;
+	if(thread->seed == 0) {
+		thread->seed = (thread->stat.id * 0x9E3779B97F4A7C15ull) | 1;
+		thread->sample = interval(thread, rate);
+	}
+
+	thread->sample -= nbytes;
+	if(thread->sample >= 0)
+		return;
+
+	thread->sample = interval(thread, rate);
+
+	sample = _slab_alloc(sizeof(struct sample_t));
+	sample->ptr = ptr;
+	sample->nbytes = nbytes;
+	mem_zero(sample->trace, sizeof(sample->trace));
+	_backtrace(sample->trace, PROF_DEPTH);
+
+	for(sample->depth = 0; sample->depth < PROF_DEPTH; sample->depth++) {
+		if(sample->trace[sample->depth] == NULL)
+			break;
+	}
+
+	idx = bucket(ptr);
+	_mutex_lock(&locks[idx % PROF_STRIPES]);
+
+	sample->next = table[idx];
+	__atomic_store_n(&table[idx], sample, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&_prof_live, 1, __ATOMIC_RELAXED);
+
+	_mutex_unlock(&locks[idx % PROF_STRIPES]);
+}
+
+/**
+ * Remove the sample for memory being freed, if any. Only buckets holding
+ * samples are locked.
+ *   @ptr: The memory.
+ */
+
+void _prof_remove(void *ptr)
+{
+	unsigned int idx;
+	struct sample_t **iter, *sample = NULL;
+
+	idx = bucket(ptr);
+	if(__atomic_load_n(&table[idx], __ATOMIC_ACQUIRE) == NULL)
+		return;
+
+	_mutex_lock(&locks[idx % PROF_STRIPES]);
+
+	for(iter = &table[idx]; *iter != NULL; iter = &(*iter)->next) {
+		if((*iter)->ptr == ptr) {
+			sample = *iter;
+			__atomic_store_n(iter, sample->next, __ATOMIC_RELAXED);
+			__atomic_sub_fetch(&_prof_live, 1, __ATOMIC_RELAXED);
+			break;
+		}
+	}
+
+	_mutex_unlock(&locks[idx % PROF_STRIPES]);
+
+	if(sample != NULL)
+		_slab_free(sample);
+}
+
+
+/**
+ * Compute the bucket of a pointer.
+ *   @ptr: The pointer.
+ *   &returns: The bucket index.
+ */
+
+static unsigned int bucket(void *ptr)
+{
+	return (((uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ull) >> (64 - PROF_BITS);
+}
+
+/**
+ * Draw the number of bytes until the next sample. Intervals are
+ * exponentially distributed so that every byte is equally likely to be
+ * sampled.
+ *   @thread: The thread record.
+ *   @rate: The mean interval.
+ *   &returns: The interval.
+ */
+
+static int64_t interval(struct _res_thread_t *thread, size_t rate)
+{
+	uint64_t x = thread->seed;
+	double u;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	thread->seed = x;
+
+	u = ((x * 0x2545F4914F6CDD1Dull) >> 11) * (1.0 / 9007199254740992.0);
+
+	return (int64_t)(-log(1.0 - u) * rate) + 1;
+}
+
+
+/**
+ * Copy the live samples, sorted by backtrace.
+ *   @cnt: Out. The number of samples.
+ *   &returns: The sample array, freed with '_slab_free'.
+ */
+
+static struct sample_t *snapshot(size_t *cnt)
+{
+	unsigned int i, k;
+	size_t n = 0, max = 64;
+	struct sample_t *list, *sample;
+
+	list = _slab_alloc(max * sizeof(struct sample_t));
+
+	for(i = 0; i < PROF_STRIPES; i++) {
+		_mutex_lock(&locks[i]);
+
+		for(k = i; k < PROF_BUCKETS; k += PROF_STRIPES) {
+			for(sample = table[k]; sample != NULL; sample = sample->next) {
+				if(n == max)
+					list = _slab_realloc(list, (max *= 2) * sizeof(struct sample_t));
+
+				list[n++] = *sample;
+			}
+		}
+
+		_mutex_unlock(&locks[i]);
+	}
+
+	qsort(list, n, sizeof(struct sample_t), sample_cmp);
+	*cnt = n;
+
+	return list;
+}
+
+/**
+ * Compare two samples by backtrace.
+ *   @left: The left sample.
+ *   @right: The right sample.
+ *   &returns: Their order.
+ */
+
+static int sample_cmp(const void *left, const void *right)
+{
+	const struct sample_t *a = left, *b = right;
+
+	if(a->depth != b->depth)
+		return (a->depth < b->depth) ? -1 : 1;
+
+	return memcmp(a->trace, b->trace, a->depth * sizeof(void *));
+}
+
+/**
+ * Check if two samples have the same backtrace.
+ *   @left: The left sample.
+ *   @right: The right sample.
+ *   &returns: True if the same.
+ */
+
+static bool sample_same(const struct sample_t *left, const struct sample_t *right)
+{
+	return sample_cmp(left, right) == 0;
+}
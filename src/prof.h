@@ -0,0 +1,60 @@
+#ifndef PROF_H
+#define PROF_H
+
+/**
+ * Profile format enumerator.
+ *   @prof_pprof_e: The pprof legacy heap profile text.
+ *   @prof_folded_e: Folded stacks, one per line, with estimated bytes.
+ */
+
+enum prof_format_e {
+	prof_pprof_e,
+	prof_folded_e
+};
+
+/*
+ * profiler variables
+ */
+
+extern size_t _prof_rate;
+extern size_t _prof_live;
+
+/*
+ * profiler function declarations
+ */
+
+void _prof_init(void);
+void _prof_destroy(void);
+
+void prof_start(size_t rate);
+void prof_stop(void);
+void prof_write(struct io_output_t output, enum prof_format_e format);
+
+void _prof_count(void *ptr, size_t nbytes);
+void _prof_remove(void *ptr);
+
+
+/**
+ * Account an allocation with the profiler.
+ *   @ptr: The allocated memory.
+ *   @nbytes: The number of bytes.
+ */
+
+static inline void _prof_alloc(void *ptr, size_t nbytes)
+{
+	if(__atomic_load_n(&_prof_rate, __ATOMIC_RELAXED) != 0)
+		_prof_count(ptr, nbytes);
+}
+
+/**
+ * Account a free with the profiler.
+ *   @ptr: The memory being freed.
+ */
+
+static inline void _prof_free(void *ptr)
+{
+	if(__atomic_load_n(&_prof_live, __ATOMIC_RELAXED) != 0)
+		_prof_remove(ptr);
+}
+
+#endif
@@ -3,19 +3,63 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include "mem.h"
 #include "posix/inc.h"
 
 
+/*
+ * arena definitions
+ */
+
+#define ARENA_CHUNK	(64 * 1024)
+#define ARENA_ALIGN(n)	(((n) + 15) & ~(size_t)15)
+
+#if _notrack
+#	define chunk_alloc(nbytes) _slab_span(nbytes)
+#	define chunk_free(chunk) _slab_unspan(chunk)
+#else
+#	define chunk_alloc(nbytes) malloc(nbytes)
+#	define chunk_free(chunk) free(chunk)
+#endif
+
+/*
+ * return stack definitions
+ */
+
+#define RETIRED		((struct _res_mem_t *)1)
+
+/*
+ * local function declarations
+ */
+
+static void arena_release(struct res_info_t *info, bool keep);
+
+static void mem_unlink(struct _res_mem_t *mem);
+static void mem_splice(struct _res_mem_t *dest, struct _res_mem_t *src);
+static void mem_drain(struct _res_thread_t *thread);
+static void mem_reclaim(struct _res_thread_t *thread, struct _res_mem_t *mem);
+static bool mem_return(struct _res_thread_t *owner, struct _res_mem_t *mem);
+
+static void thread_exit(void *arg);
+static struct _res_thread_t *thread_new(void);
+static void thread_delete(struct _res_thread_t *thread, struct _res_mem_t *list);
+static void stat_sum(struct res_stat_t *dest, const struct res_stat_t *src);
+
+/*
+ * global variables
+ */
+
+_export __thread struct res_info_t *_res_current = NULL;
+
 /*
  * local variables
  */
 
 static _specific_t specific;
 static _mutex_t lock;
-static unsigned long memcnt, nodecnt;
-#if _debug || _test
-static size_t memnbytes;
-#endif
+static uint64_t nextid;
+static struct _res_thread_t *records;
+static struct res_stat_t retired;
 
 /*
  * extern function declarations
@@ -31,13 +75,13 @@ void _mem_release(struct _res_mem_t *mem);
 void _res_init(void)
 {
 	lock = _mutex_init();
+	_mutex_name(&lock, "res");
 
-	memcnt = nodecnt = 0;
-#if _debug || _test
-	memnbytes = 0;
-#endif
+	nextid = 0;
+	records = NULL;
+	retired = (struct res_stat_t){ 0, 0, 0, 0 };
 
-	specific = _specific_alloc(NULL);
+	specific = _specific_alloc(thread_exit);
 	res_push();
 }
 
@@ -48,20 +92,44 @@ void _res_init(void)
 void _res_destroy(void)
 {
 #if _test || _debug
-	if(memcnt > 0)
-		fprintf(stderr, "Memory leaked. Missed %lu allocations taking %zu bytes.\n", memcnt, memnbytes);
+	struct res_stat_t total;
+
+	total = res_stats(NULL, NULL);
+
+	if(total.memcnt > 0)
+		fprintf(stderr, "Memory leaked. Missed %ld allocations taking %ld bytes.\n", (long)total.memcnt, (long)total.memnbytes);
 
-	if(nodecnt > 0)
-		fprintf(stderr, "Resouces leaked. Missed %lu resources.\n", nodecnt);
+	if(total.nodecnt > 0)
+		fprintf(stderr, "Resouces leaked. Missed %ld resources.\n", (long)total.nodecnt);
 #endif
 
-	_mutex_destroy(&lock);
 	res_check();
 	res_pop();
 	_specific_free(specific);
+	_mutex_destroy(&lock);
 }
 
 
+/**
+ * Enter a thread, pushing its base resource structure if it has none.
+ */
+
+void _res_enter(void)
+{
+	if(_res_current == NULL)
+		res_push();
+}
+
+/**
+ * Leave a thread, popping all of its resource structures.
+ */
+
+void _res_leave(void)
+{
+	while(_res_current != NULL)
+		res_pop();
+}
+
 /**
  * Retrieve the current resource structure.
  *   &returns: The resource structure.
@@ -70,7 +138,7 @@ void _res_destroy(void)
 _export
 struct res_info_t *res_info(void)
 {
-	return _specific_get(specific);
+	return _res_current;
 }
 
 /**
@@ -90,8 +158,8 @@ void res_check(void)
 	void **func;
 	struct _res_mem_t *mem;
 
-	for(mem = info->mhead; mem != NULL; mem = mem->next) {
-		fprintf(stderr, "Leaked %zu bytes.\n", mem->nbytes);
+	for(mem = info->mem.next; mem != &info->mem; mem = mem->next) {
+		fprintf(stderr, "Leaked %zu bytes.\n", (size_t)mem->nbytes);
 
 		for(func = mem->trace; *func != NULL; func++)
 			fprintf(stderr, "  %p\n", *func);
@@ -100,7 +168,7 @@ void res_check(void)
 }
 
 /**
- * Retrieve the current error.
+ * Retrieve the current error, rendering its message on first read.
  *   &returns: The error or null.
  */
 
@@ -110,7 +178,27 @@ const char *res_error(void)
 	struct res_info_t *info;
 
 	info = res_info();
-	return info ? info->error : NULL;
+	if(info == NULL)
+		return NULL;
+
+	if(info->err.format != NULL)
+		_try_render(info);
+
+	return info->error;
+}
+
+/**
+ * Retrieve the code of the current error.
+ *   &returns: The code, or zero if thrown without one.
+ */
+
+_export
+int res_errcode(void)
+{
+	struct res_info_t *info;
+
+	info = res_info();
+	return info ? info->err.code : 0;
 }
 
 
@@ -127,15 +215,81 @@ struct res_info_t *res_push(void)
 	info = malloc(sizeof(struct res_info_t));
 	info->fatal = true;
 	info->up = res_info();
+	info->thread = info->up ? info->up->thread : thread_new();
+	info->seq = info->thread->seq++;
 	info->error = NULL;
-	info->mhead = info->mtail = NULL;
+	info->err.code = 0;
+	info->err.format = NULL;
+	info->mem.prev = info->mem.next = &info->mem;
 	info->nhead = info->ntail = NULL;
+	info->arena = info->nofree = false;
+	info->chunk = NULL;
+	info->cur = info->end = NULL;
+	info->usage = (struct res_usage_t){ 0, 0, 0, RES_NOBUDGET };
+	if(info->up && (info->up->usage.budget != RES_NOBUDGET))
+		info->usage.budget = info->up->usage.budget - info->up->usage.nbytes;
+
+	_res_current = info;
+	if(info->up == NULL)
+		_specific_set(specific, info);
+
+	return info;
+}
+
+/**
+ * Push an arena resource structure. Memory allocated directly in the arena
+ * scope is carved from large chunks and is released all at once by
+ * 'res_memclear' or 'res_pop'; unlike normal scopes, it is not passed up to
+ * the previous scope. Nested scopes are not arenas.
+ *   @nofree: Make 'mem_free' a no-op for carved memory.
+ *   &returns: The resource structure.
+ */
+
+_export
+struct res_info_t *res_push_arena(bool nofree)
+{
+	struct res_info_t *info;
 
-	_specific_set(specific, info);
+	info = res_push();
+	info->arena = true;
+	info->nofree = nofree;
 
 	return info;
 }
 
+/**
+ * Limit the memory of the current scope. Once the scope's bytes would
+ * exceed the budget, 'mem_alloc' throws instead of allocating. Nested
+ * scopes inherit what remains of the budget, and a budget never exceeds
+ * what remains of the enclosing one.
+ *   @nbytes: The budget in bytes, or zero to only inherit.
+ */
+
+_export
+void res_budget(size_t nbytes)
+{
+	struct res_info_t *info, *up;
+
+	info = res_info();
+	up = info->up;
+
+	info->usage.budget = (up && (up->usage.budget != RES_NOBUDGET)) ? (up->usage.budget - up->usage.nbytes) : RES_NOBUDGET;
+	if((nbytes > 0) && ((int64_t)nbytes < info->usage.budget))
+		info->usage.budget = nbytes;
+}
+
+/**
+ * Retrieve the memory usage of a scope.
+ *   @info: The scope, as returned by 'res_info' or 'res_push'.
+ *   &returns: The usage.
+ */
+
+_export
+struct res_usage_t res_usage(const struct res_info_t *info)
+{
+	return info->usage;
+}
+
 /**
  * Pop a resource structure.
  */
@@ -162,20 +316,27 @@ void res_pop()
 			up->ntail = info->ntail;
 		}
 
-		if(info->mhead != NULL) {
-			if(up->mtail != NULL)
-				up->mtail->next = info->mhead;
-			else
-				up->mhead = info->mhead;
+		mem_splice(&up->mem, &info->mem);
 
-			info->mhead->prev = up->mtail;
-			up->mtail = info->mtail;
-		}
+		if(up->usage.nbytes + info->usage.peak > up->usage.peak)
+			up->usage.peak = up->usage.nbytes + info->usage.peak;
+
+		if(!info->arena)
+			up->usage.nbytes += info->usage.nbytes;
+
+		up->usage.nallocs += info->usage.nallocs;
 	}
 
+	arena_release(info, false);
+
+	if(up == NULL)
+		thread_delete(info->thread, &info->mem);
+
 	free(info);
 
-	_specific_set(specific, up);
+	_res_current = up;
+	if(up == NULL)
+		_specific_set(specific, NULL);
 }
 
 
@@ -201,21 +362,26 @@ void res_memclear()
 	struct _res_mem_t *cur, *next;
 
 	info = res_info();
+	mem_drain(info->thread);
 
-	cur = info->mhead;
-	while(cur != NULL) {
+	cur = info->mem.next;
+	while(cur != &info->mem) {
 		next = cur->next;
 
-		memcnt--;
+		_res_stat(&info->thread->stat.memcnt, -1);
 #if _debug || _test
-		memnbytes -= cur->nbytes;
+		_res_stat(&info->thread->stat.memnbytes, -(int64_t)cur->nbytes);
 #endif
 		_mem_release(cur);
 
 		cur = next;
 	}
 
-	info->mhead = info->mtail = NULL;
+	info->mem.prev = info->mem.next = &info->mem;
+	arena_release(info, true);
+
+	if(!_notrack || info->arena)
+		info->usage.nbytes = 0;
 }
 
 /**
@@ -234,7 +400,7 @@ void res_nodeclear()
 	while(cur != NULL) {
 		prev = cur->prev;
 
-		nodecnt--;
+		_res_stat(&info->thread->stat.nodecnt, -1);
 		cur->destroy((void *)cur - cur->offset);
 
 		cur = prev;
@@ -260,51 +426,146 @@ void _res_add(struct _res_mem_t *mem, size_t nbytes)
 	_backtrace(mem->trace, RES_NTRACE);
 #endif
 
-	_mutex_lock(&lock);
-	memcnt++;
+	if(__atomic_load_n(&info->thread->ret, __ATOMIC_RELAXED) != NULL)
+		mem_drain(info->thread);
+
+	_res_stat(&info->thread->stat.memcnt, 1);
 #if _debug || _test
-	memnbytes += mem->nbytes = nbytes;
+	_res_stat(&info->thread->stat.memnbytes, nbytes);
 #endif
-	_mutex_unlock(&lock);
-
-	mem->prev = info->mtail;
-	mem->next = NULL;
 
-	if(info->mtail != NULL)
-		info->mtail->next = mem;
-	else
-		info->mhead = mem;
+	mem->nbytes = nbytes;
+	mem->seq = info->seq;
 
-	info->mtail = mem;
+	mem->owner = info->thread;
+	mem->next = &info->mem;
+	mem->prev = info->mem.prev;
+	info->mem.prev->next = mem;
+	info->mem.prev = mem;
 }
 
 /**
- * Remove a memory resource.
+ * Remove a memory resource. Memory owned by another thread is handed back
+ * to its owner, which releases it later.
  *   @mem: The memory resource.
+ *   &returns: True if the caller should release the memory.
  */
 
-void _res_remove(struct _res_mem_t *mem)
+bool _res_remove(struct _res_mem_t *mem)
 {
 	struct res_info_t *info;
 
-	_mutex_lock(&lock);
-	memcnt--;
+	info = res_info();
+	if(mem->owner != info->thread)
+		return mem_return(mem->owner, mem);
+
+	_res_stat(&info->thread->stat.memcnt, -1);
 #if _debug || _test
-	memnbytes -= mem->nbytes;
+	_res_stat(&info->thread->stat.memnbytes, -(int64_t)mem->nbytes);
 #endif
-	_mutex_unlock(&lock);
 
-	info = res_info();
+	mem_unlink(mem);
 
-	if(mem->next == NULL)
-		info->mtail = mem->prev;
-	else
-		mem->next->prev = mem->prev;
+	return true;
+}
 
-	if(mem->prev == NULL)
-		info->mhead = mem->next;
-	else
-		mem->prev->next = mem->next;
+/**
+ * Unlink a memory node from its list.
+ *   @mem: The memory node.
+ */
+
+static void mem_unlink(struct _res_mem_t *mem)
+{
+	mem->prev->next = mem->next;
+	mem->next->prev = mem->prev;
+}
+
+/**
+ * Move all nodes of a list to the end of another list.
+ *   @dest: The destination sentinel.
+ *   @src: The source sentinel, left empty.
+ */
+
+static void mem_splice(struct _res_mem_t *dest, struct _res_mem_t *src)
+{
+	if(src->next == src)
+		return;
+
+	src->next->prev = dest->prev;
+	src->prev->next = dest;
+	dest->prev->next = src->next;
+	dest->prev = src->prev;
+	src->prev = src->next = src;
+}
+
+/**
+ * Reclaim all memory returned to a thread by other threads.
+ *   @thread: The current thread record.
+ */
+
+static void mem_drain(struct _res_thread_t *thread)
+{
+	mem_reclaim(thread, __atomic_exchange_n(&thread->ret, NULL, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Release a list of returned memory.
+ *   @thread: The current thread record.
+ *   @mem: The return stack.
+ */
+
+static void mem_reclaim(struct _res_thread_t *thread, struct _res_mem_t *mem)
+{
+	struct _res_mem_t *next;
+
+	while(mem != NULL) {
+		next = mem->owner;
+
+		_res_stat(&thread->stat.memcnt, -1);
+#if _debug || _test
+		_res_stat(&thread->stat.memnbytes, -(int64_t)mem->nbytes);
+#endif
+		mem_unlink(mem);
+		_mem_release(mem);
+
+		mem = next;
+	}
+}
+
+/**
+ * Return memory to the thread that owns it. If the owner has exited, the
+ * memory is unlinked from its orphan list under the lock instead.
+ *   @owner: The owning thread record.
+ *   @mem: The memory node.
+ *   &returns: True if the caller should release the memory.
+ */
+
+static bool mem_return(struct _res_thread_t *owner, struct _res_mem_t *mem)
+{
+	struct _res_mem_t *top;
+	struct _res_thread_t *thread = res_info()->thread;
+
+	top = __atomic_load_n(&owner->ret, __ATOMIC_RELAXED);
+	do {
+		if(top == RETIRED) {
+			_res_stat(&thread->stat.memcnt, -1);
+#if _debug || _test
+			_res_stat(&thread->stat.memnbytes, -(int64_t)mem->nbytes);
+#endif
+
+			_mutex_lock(&lock);
+			mem_unlink(mem);
+			if(owner->orphan.next == &owner->orphan)
+				free(owner);
+			_mutex_unlock(&lock);
+
+			return true;
+		}
+
+		mem->owner = top;
+	} while(!__atomic_compare_exchange_n(&owner->ret, &top, mem, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return false;
 }
 
 
@@ -326,9 +587,7 @@ void res_add(struct _res_node_t *node, ssize_t offset, void (*destroy)(void *))
 	//_backtrace(node->trace, RES_NTRACE);
 #endif
 
-	_mutex_lock(&lock);
-	nodecnt++;
-	_mutex_unlock(&lock);
+	_res_stat(&info->thread->stat.nodecnt, 1);
 
 	node->prev = info->ntail;
 	node->next = NULL;
@@ -355,9 +614,7 @@ void res_remove(struct _res_node_t *node)
 
 	info = res_info();
 
-	_mutex_lock(&lock);
-	nodecnt--;
-	_mutex_unlock(&lock);
+	_res_stat(&info->thread->stat.nodecnt, -1);
 
 	if(node->next == NULL)
 		info->ntail = node->prev;
@@ -369,3 +626,274 @@ void res_remove(struct _res_node_t *node)
 	else
 		node->prev->next = node->next;
 }
+
+
+/**
+ * Take a snapshot of the resource statistics. Counters are read without
+ * stopping other threads, so the snapshot is only approximate while they
+ * are running.
+ *   @threads: Optional. The per-thread statistics array.
+ *   @cnt: Optional. The array capacity, set to the number of entries
+ *     written.
+ *   &returns: The totals, including exited threads.
+ */
+
+_export
+struct res_stat_t res_stats(struct res_stat_t *threads, unsigned int *cnt)
+{
+	unsigned int n = 0;
+	struct res_stat_t total;
+	struct _res_thread_t *thread;
+
+	_mutex_lock(&lock);
+
+	total = retired;
+	for(thread = records; thread != NULL; thread = thread->next) {
+		struct res_stat_t stat;
+
+		stat.id = thread->stat.id;
+		stat.memcnt = __atomic_load_n(&thread->stat.memcnt, __ATOMIC_RELAXED);
+		stat.nodecnt = __atomic_load_n(&thread->stat.nodecnt, __ATOMIC_RELAXED);
+		stat.memnbytes = __atomic_load_n(&thread->stat.memnbytes, __ATOMIC_RELAXED);
+
+		stat_sum(&total, &stat);
+		if((threads != NULL) && (n < *cnt))
+			threads[n++] = stat;
+	}
+
+	_mutex_unlock(&lock);
+
+	if(cnt != NULL)
+		*cnt = n;
+
+	total.id = 0;
+
+	return total;
+}
+
+/**
+ * Release the resource structures of an exiting thread that did not leave,
+ * such as one ending through 'pthread_exit'.
+ *   @arg: The base resource structure.
+ */
+
+static void thread_exit(void *arg)
+{
+	_res_leave();
+}
+
+/**
+ * Create and register a thread record.
+ *   &returns: The thread record.
+ */
+
+static struct _res_thread_t *thread_new(void)
+{
+	struct _res_thread_t *thread;
+
+	thread = malloc(sizeof(struct _res_thread_t));
+	thread->stat = (struct res_stat_t){ 0, 0, 0, 0 };
+	thread->prev = NULL;
+	thread->ret = NULL;
+	thread->orphan.prev = thread->orphan.next = &thread->orphan;
+	thread->sample = 0;
+	thread->seed = 0;
+	thread->seq = 0;
+
+	_mutex_lock(&lock);
+
+	thread->stat.id = ++nextid;
+	thread->next = records;
+	if(records != NULL)
+		records->prev = thread;
+
+	records = thread;
+
+	_mutex_unlock(&lock);
+
+	return thread;
+}
+
+/**
+ * Unregister and delete a thread record, folding its counts into the
+ * retired totals. If memory is still allocated, the record is kept with the
+ * memory on its orphan list until other threads free it.
+ *   @thread: The thread record.
+ *   @list: The list sentinel of remaining memory.
+ */
+
+static void thread_delete(struct _res_thread_t *thread, struct _res_mem_t *list)
+{
+	_mutex_lock(&lock);
+
+	mem_reclaim(thread, __atomic_exchange_n(&thread->ret, RETIRED, __ATOMIC_ACQUIRE));
+
+	mem_splice(&thread->orphan, list);
+	stat_sum(&retired, &thread->stat);
+
+	if(thread->prev != NULL)
+		thread->prev->next = thread->next;
+	else
+		records = thread->next;
+
+	if(thread->next != NULL)
+		thread->next->prev = thread->prev;
+
+	if(thread->orphan.next == &thread->orphan)
+		free(thread);
+
+	_mutex_unlock(&lock);
+}
+
+/**
+ * Add statistics into a sum.
+ *   @dest: The destination sum.
+ *   @src: The source statistics.
+ */
+
+static void stat_sum(struct res_stat_t *dest, const struct res_stat_t *src)
+{
+	dest->memcnt += src->memcnt;
+	dest->nodecnt += src->nodecnt;
+	dest->memnbytes += src->memnbytes;
+}
+
+
+/**
+ * Carve memory from the arena of a scope.
+ *   @info: The resource structure.
+ *   @nbytes: The number of bytes.
+ *   &returns: The allocated memory, following the memory node.
+ */
+
+void *_res_carve(struct res_info_t *info, size_t nbytes)
+{
+	size_t size;
+	struct _res_mem_t *mem;
+	struct _res_chunk_t *chunk;
+
+	size = ARENA_ALIGN(sizeof(struct _res_mem_t) + nbytes);
+
+	if(size <= (size_t)(info->end - info->cur)) {
+		mem = (struct _res_mem_t *)info->cur;
+		info->cur += size;
+	}
+	else if(size > ARENA_CHUNK / 4) {
+		chunk = chunk_alloc(sizeof(struct _res_chunk_t) + size);
+		chunk->nbytes = size;
+
+		if(info->cur != NULL) {
+			chunk->next = info->chunk->next;
+			info->chunk->next = chunk;
+		}
+		else {
+			chunk->next = info->chunk;
+			info->chunk = chunk;
+		}
+
+		mem = (struct _res_mem_t *)(chunk + 1);
+	}
+	else {
+		chunk = chunk_alloc(sizeof(struct _res_chunk_t) + ARENA_CHUNK);
+		chunk->nbytes = ARENA_CHUNK;
+		chunk->next = info->chunk;
+		info->chunk = chunk;
+
+		mem = (struct _res_mem_t *)(chunk + 1);
+		info->cur = (uint8_t *)mem + size;
+		info->end = (uint8_t *)mem + ARENA_CHUNK;
+	}
+
+	mem->prev = (void *)((uintptr_t)info | 1);
+	mem->next = (void *)nbytes;
+	mem->owner = info->thread;
+#if _debug || _test
+	mem->nbytes = nbytes;
+#endif
+
+	return mem + 1;
+}
+
+/**
+ * Free carved memory. Only the most recent carve is reclaimed, and only if
+ * the arena allows freeing and belongs to the calling thread.
+ *   @mem: The memory node.
+ */
+
+void _res_uncarve(struct _res_mem_t *mem)
+{
+	struct res_info_t *info = (void *)((uintptr_t)mem->prev & ~(uintptr_t)1);
+
+	if(info->nofree || (mem->owner != res_info()->thread))
+		return;
+
+	if((uint8_t *)mem + ARENA_ALIGN(sizeof(struct _res_mem_t) + (size_t)mem->next) == info->cur)
+		info->cur = (uint8_t *)mem;
+}
+
+/**
+ * Resize carved memory. The most recent carve is grown in place when the
+ * chunk has room, otherwise the data is copied to a new carve. Memory
+ * carved by another thread is copied to a new allocation in the current
+ * scope, leaving the foreign arena untouched.
+ *   @mem: The memory node.
+ *   @nbytes: The new number of bytes.
+ *   &returns: The memory.
+ */
+
+void *_res_recarve(struct _res_mem_t *mem, size_t nbytes)
+{
+	void *ptr;
+	size_t prev = (size_t)mem->next;
+	struct res_info_t *info = (void *)((uintptr_t)mem->prev & ~(uintptr_t)1);
+
+	if(mem->owner != res_info()->thread) {
+		ptr = mem_alloc(nbytes);
+		memcpy(ptr, mem + 1, (prev < nbytes) ? prev : nbytes);
+
+		return ptr;
+	}
+
+	if(((uint8_t *)mem + ARENA_ALIGN(sizeof(struct _res_mem_t) + prev) == info->cur) && (ARENA_ALIGN(sizeof(struct _res_mem_t) + nbytes) <= (size_t)(info->end - (uint8_t *)mem))) {
+		info->cur = (uint8_t *)mem + ARENA_ALIGN(sizeof(struct _res_mem_t) + nbytes);
+		mem->next = (void *)nbytes;
+#if _debug || _test
+		mem->nbytes = nbytes;
+#endif
+
+		return mem + 1;
+	}
+
+	ptr = _res_carve(info, nbytes);
+	memcpy(ptr, mem + 1, (prev < nbytes) ? prev : nbytes);
+
+	return ptr;
+}
+
+/**
+ * Release the arena chunks of a scope.
+ *   @info: The resource structure.
+ *   @keep: Keep the current chunk for reuse.
+ */
+
+static void arena_release(struct res_info_t *info, bool keep)
+{
+	struct _res_chunk_t *chunk, *next;
+
+	chunk = info->chunk;
+	if(keep && (info->cur != NULL)) {
+		info->cur = (uint8_t *)(chunk + 1);
+		chunk = chunk->next;
+		info->chunk->next = NULL;
+	}
+	else {
+		info->chunk = NULL;
+		info->cur = info->end = NULL;
+	}
+
+	while(chunk != NULL) {
+		next = chunk->next;
+		chunk_free(chunk);
+		chunk = next;
+	}
+}
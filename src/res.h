@@ -1,15 +1,24 @@
 #ifndef RES_H
 #define RES_H
 
+/*
+ * resource variables
+ */
+
+extern __thread struct res_info_t *_res_current;
+
 /*
  * resource function declarations
  */
 
-struct res_info_t *res_info(void);
 void res_check(void);
 const char *res_error(void);
+int res_errcode(void);
 
 struct res_info_t *res_push(void);
+struct res_info_t *res_push_arena(bool nofree);
+void res_budget(size_t nbytes);
+struct res_usage_t res_usage(const struct res_info_t *info);
 void res_pop(void);
 
 void res_clear(void);
@@ -19,10 +28,23 @@ void res_nodeclear(void);
 void res_add(struct _res_node_t *node, ssize_t offset, void (*destroy)(void *));
 void res_remove(struct _res_node_t *node);
 
+struct res_stat_t res_stats(struct res_stat_t *threads, unsigned int *cnt);
+
 /*
  * convenience macros
  */
 
 #define errstr res_error()
 
+
+/**
+ * Retrieve the current resource structure.
+ *   &returns: The resource structure.
+ */
+
+_inline struct res_info_t *res_info(void)
+{
+	return _res_current;
+}
+
 #endif
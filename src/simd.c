@@ -0,0 +1,688 @@
+#include "common.h"
+#include "string.h"
+
+#if defined(__x86_64__)
+#	include <immintrin.h>
+#endif
+
+
+/*
+ * word definitions
+ */
+
+#define ONES	0x0101010101010101ull
+#define HIGHS	0x8080808080808080ull
+#define PAGE	4096
+
+/*
+ * local function declarations
+ */
+
+static void swap_word(void *left, void *right, size_t nbytes);
+static void case_word(char *str, char lo);
+static const char *prefixi_word(const char *left, const char *right);
+static const char *wbrk_word(const char *str);
+static bool iszero_word(const void *ptr, size_t nbytes);
+static size_t enc_none(char *restrict dest, const uint8_t *restrict src, size_t nbytes);
+static size_t dec_none(uint8_t *restrict dest, const char *restrict src, size_t len);
+static size_t bswap_none(void *dest, const void *src, size_t cnt);
+
+#if defined(__x86_64__)
+static void swap_sse2(void *left, void *right, size_t nbytes);
+static void swap_avx2(void *left, void *right, size_t nbytes);
+static void case_sse2(char *str, char lo);
+static void case_avx2(char *str, char lo);
+static const char *prefixi_sse2(const char *left, const char *right);
+static const char *wbrk_sse2(const char *str);
+static const char *wbrk_avx2(const char *str);
+static bool iszero_sse2(const void *ptr, size_t nbytes);
+static bool iszero_avx2(const void *ptr, size_t nbytes);
+#endif
+
+/*
+ * global variables
+ */
+
+void (*_simd_swap)(void *left, void *right, size_t nbytes) = swap_word;
+void (*_simd_case)(char *str, char lo) = case_word;
+const char *(*_simd_prefixi)(const char *left, const char *right) = prefixi_word;
+const char *(*_simd_wbrk)(const char *str) = wbrk_word;
+bool (*_simd_iszero)(const void *ptr, size_t nbytes) = iszero_word;
+size_t (*_simd_hex_enc)(char *restrict dest, const uint8_t *restrict src, size_t nbytes) = enc_none;
+size_t (*_simd_base64_enc)(char *restrict dest, const uint8_t *restrict src, size_t nbytes) = enc_none;
+size_t (*_simd_base64_dec)(uint8_t *restrict dest, const char *restrict src, size_t len) = dec_none;
+size_t (*_simd_bswap16)(void *dest, const void *src, size_t cnt) = bswap_none;
+size_t (*_simd_bswap32)(void *dest, const void *src, size_t cnt) = bswap_none;
+size_t (*_simd_bswap64)(void *dest, const void *src, size_t cnt) = bswap_none;
+
+
+/**
+ * Select the primitives for the running processor. Until called, the
+ * portable word-wise primitives are used.
+ */
+
+void _simd_init(void)
+{
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+
+	_simd_swap = swap_sse2;
+	_simd_case = case_sse2;
+	_simd_prefixi = prefixi_sse2;
+	_simd_wbrk = wbrk_sse2;
+	_simd_iszero = iszero_sse2;
+
+	if(__builtin_cpu_supports("ssse3")) {
+		_simd_hex_enc = _hex_enc_ssse3;
+		_simd_base64_enc = _base64_enc_ssse3;
+		_simd_base64_dec = _base64_dec_ssse3;
+		_simd_bswap16 = _bswap16_ssse3;
+		_simd_bswap32 = _bswap32_ssse3;
+		_simd_bswap64 = _bswap64_ssse3;
+	}
+
+	if(__builtin_cpu_supports("avx2")) {
+		_simd_swap = swap_avx2;
+		_simd_case = case_avx2;
+		_simd_wbrk = wbrk_avx2;
+		_simd_iszero = iszero_avx2;
+		_simd_hex_enc = _hex_enc_avx2;
+		_simd_base64_enc = _base64_enc_avx2;
+		_simd_base64_dec = _base64_dec_avx2;
+	}
+#endif
+}
+
+
+/**
+ * Load a word from unaligned memory.
+ *   @ptr: The pointer.
+ *   &returns: The word.
+ */
+
+static inline uint64_t word_load(const void *ptr)
+{
+	uint64_t word;
+
+	__builtin_memcpy(&word, ptr, sizeof(uint64_t));
+
+	return word;
+}
+
+/**
+ * Store a word to unaligned memory.
+ *   @ptr: The pointer.
+ *   @word: The word.
+ */
+
+static inline void word_store(void *ptr, uint64_t word)
+{
+	__builtin_memcpy(ptr, &word, sizeof(uint64_t));
+}
+
+/**
+ * Find the bytes of a word that are zero.
+ *   @word: The word.
+ *   &returns: The high bit of every zero byte is set, though bytes above
+ *     the first zero may be falsely marked.
+ */
+
+static inline uint64_t word_zero(uint64_t word)
+{
+	return (word - ONES) & ~word & HIGHS;
+}
+
+/**
+ * Find the bytes of a word in the ASCII range from 'lo' to 'lo + 25'.
+ *   @word: The word.
+ *   @lo: The first character of the range.
+ *   &returns: The high bit of every matching byte is set.
+ */
+
+static inline uint64_t word_range(uint64_t word, char lo)
+{
+	uint64_t set = word | HIGHS;
+
+	return ~word & (set - ONES * (uint8_t)lo) & ~(set - ONES * (uint8_t)(lo + 26)) & HIGHS;
+}
+
+/**
+ * Fold the case of a word to lowercase.
+ *   @word: The word.
+ *   &returns: The folded word.
+ */
+
+static inline uint64_t word_lower(uint64_t word)
+{
+	return word | (word_range(word, 'A') >> 2);
+}
+
+/**
+ * Check if a character is whitespace in the C locale.
+ *   @ch: The character.
+ *   &returns: True if whitespace.
+ */
+
+static inline bool ch_isspace(char ch)
+{
+	return (ch == ' ') || ((ch >= '\t') && (ch <= '\r'));
+}
+
+/**
+ * Check if a read of a number of bytes stays within one page.
+ *   @ptr: The pointer.
+ *   @nbytes: The number of bytes.
+ *   &returns: True if the read stays in the page.
+ */
+
+static inline bool page_safe(const void *ptr, size_t nbytes)
+{
+	return ((uintptr_t)ptr & (PAGE - 1)) <= PAGE - nbytes;
+}
+
+
+/**
+ * Swap the contents of two buffers a word at a time.
+ *   @left: The left buffer.
+ *   @right: The right buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+static void swap_word(void *left, void *right, size_t nbytes)
+{
+	uint64_t t;
+	uint8_t b, *lptr = left, *rptr = right;
+
+	for(; nbytes >= sizeof(uint64_t); nbytes -= sizeof(uint64_t)) {
+		t = word_load(lptr);
+		word_store(lptr, word_load(rptr));
+		word_store(rptr, t);
+
+		lptr += sizeof(uint64_t);
+		rptr += sizeof(uint64_t);
+	}
+
+	while(nbytes-- > 0) {
+		b = *lptr;
+		*lptr++ = *rptr;
+		*rptr++ = b;
+	}
+}
+
+/**
+ * Flip the case of the ASCII letters in a string, starting with 'lo', one
+ * byte at a time.
+ *   @str: The string.
+ *   @lo: The first letter to flip, either 'A' or 'a'.
+ */
+
+static inline void case_byte(char *str, char lo)
+{
+	for(; *str != '\0'; str++) {
+		if((*str >= lo) && (*str <= lo + 25))
+			*str ^= 0x20;
+	}
+}
+
+/**
+ * Flip the case of the ASCII letters in a string a word at a time.
+ *   @str: The string.
+ *   @lo: The first letter to flip, either 'A' or 'a'.
+ */
+
+static void case_word(char *str, char lo)
+{
+	uint64_t word;
+
+	for(; (uintptr_t)str % sizeof(uint64_t) != 0; str++) {
+		if(*str == '\0')
+			return;
+		else if((*str >= lo) && (*str <= lo + 25))
+			*str ^= 0x20;
+	}
+
+	while(true) {
+		word = word_load(str);
+		if(word_zero(word) != 0)
+			break;
+
+		word_store(str, word ^ (word_range(word, lo) >> 2));
+		str += sizeof(uint64_t);
+	}
+
+	case_byte(str, lo);
+}
+
+/**
+ * Check if a string starts with a prefix, ignoring ASCII case, a word at a
+ * time where reads stay within a page.
+ *   @left: The string.
+ *   @right: The prefix.
+ *   &returns: The end of the prefix in the string, or null.
+ */
+
+static const char *prefixi_word(const char *left, const char *right)
+{
+	uint64_t lword, rword;
+
+	while(true) {
+		if(page_safe(left, sizeof(uint64_t)) && page_safe(right, sizeof(uint64_t))) {
+			lword = word_load(left);
+			rword = word_load(right);
+
+			if(word_zero(rword) == 0) {
+				if(word_lower(lword) != word_lower(rword))
+					return NULL;
+
+				left += sizeof(uint64_t);
+				right += sizeof(uint64_t);
+
+				continue;
+			}
+		}
+
+		if(*right == '\0')
+			return left;
+		else if(ch_tolower(*left) != ch_tolower(*right))
+			return NULL;
+
+		left++;
+		right++;
+	}
+}
+
+/**
+ * Find the first whitespace in a string a word at a time.
+ *   @str: The string.
+ *   &returns: The whitespace, or null if the string ends first.
+ */
+
+static const char *wbrk_word(const char *str)
+{
+	unsigned int i;
+	uint64_t word;
+
+	for(; (uintptr_t)str % sizeof(uint64_t) != 0; str++) {
+		if(ch_isspace(*str))
+			return str;
+		else if(*str == '\0')
+			return NULL;
+	}
+
+	while(true) {
+		word = word_load(str);
+		if(((word_zero(word ^ (ONES * ' ')) | ((word - ONES * 14) & ~word & HIGHS))) != 0) {
+			for(i = 0; i < sizeof(uint64_t); i++) {
+				if(ch_isspace(str[i]))
+					return str + i;
+				else if(str[i] == '\0')
+					return NULL;
+			}
+		}
+
+		str += sizeof(uint64_t);
+	}
+}
+
+/**
+ * Check if a buffer is all zero a word at a time.
+ *   @ptr: The buffer.
+ *   @nbytes: The number of bytes.
+ *   &returns: True if all zero.
+ */
+
+static bool iszero_word(const void *ptr, size_t nbytes)
+{
+	uint64_t acc = 0;
+	const uint8_t *byte = ptr;
+
+	for(; nbytes >= sizeof(uint64_t); nbytes -= sizeof(uint64_t), byte += sizeof(uint64_t)) {
+		acc |= word_load(byte);
+		if((nbytes % 256 < sizeof(uint64_t)) && (acc != 0))
+			return false;
+	}
+
+	while(nbytes-- > 0)
+		acc |= *byte++;
+
+	return acc == 0;
+}
+
+/**
+ * Encode nothing, leaving the whole buffer to the portable loop.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @nbytes: The number of bytes.
+ *   &returns: Always zero.
+ */
+
+static size_t enc_none(char *restrict dest, const uint8_t *restrict src, size_t nbytes)
+{
+	return 0;
+}
+
+/**
+ * Decode nothing, leaving the whole buffer to the portable loop.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @len: The number of characters.
+ *   &returns: Always zero.
+ */
+
+static size_t dec_none(uint8_t *restrict dest, const char *restrict src, size_t len)
+{
+	return 0;
+}
+
+/**
+ * Byte swap nothing, leaving the whole array to the portable loop.
+ *   @dest: The destination.
+ *   @src: The source.
+ *   @cnt: The number of elements.
+ *   &returns: Always zero.
+ */
+
+static size_t bswap_none(void *dest, const void *src, size_t cnt)
+{
+	return 0;
+}
+
+
+#if defined(__x86_64__)
+
+/**
+ * Swap the contents of two buffers sixteen bytes at a time.
+ *   @left: The left buffer.
+ *   @right: The right buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+static void swap_sse2(void *left, void *right, size_t nbytes)
+{
+	size_t i;
+	__m128i l, r;
+
+	for(i = 0; i + 16 <= nbytes; i += 16) {
+		l = _mm_loadu_si128((const __m128i *)(left + i));
+		r = _mm_loadu_si128((const __m128i *)(right + i));
+		_mm_storeu_si128((__m128i *)(left + i), r);
+		_mm_storeu_si128((__m128i *)(right + i), l);
+	}
+
+	swap_word(left + i, right + i, nbytes - i);
+}
+
+/**
+ * Swap the contents of two buffers using AVX2, 64 bytes at a time.
+ *   @left: The left buffer.
+ *   @right: The right buffer.
+ *   @nbytes: The number of bytes.
+ */
+
+__attribute__((target("avx2")))
+static void swap_avx2(void *left, void *right, size_t nbytes)
+{
+	size_t i;
+	__m256i l0, l1, r0, r1;
+
+	for(i = 0; i + 64 <= nbytes; i += 64) {
+		l0 = _mm256_loadu_si256((const __m256i *)(left + i));
+		l1 = _mm256_loadu_si256((const __m256i *)(left + i + 32));
+		r0 = _mm256_loadu_si256((const __m256i *)(right + i));
+		r1 = _mm256_loadu_si256((const __m256i *)(right + i + 32));
+		_mm256_storeu_si256((__m256i *)(left + i), r0);
+		_mm256_storeu_si256((__m256i *)(left + i + 32), r1);
+		_mm256_storeu_si256((__m256i *)(right + i), l0);
+		_mm256_storeu_si256((__m256i *)(right + i + 32), l1);
+	}
+
+	swap_sse2(left + i, right + i, nbytes - i);
+}
+
+/**
+ * Flip the case of the ASCII letters in a string sixteen bytes at a time.
+ * Aligned loads never cross a page.
+ *   @str: The string.
+ *   @lo: The first letter to flip, either 'A' or 'a'.
+ */
+
+static void case_sse2(char *str, char lo)
+{
+	__m128i v, in;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i min = _mm_set1_epi8(lo - 1), max = _mm_set1_epi8(lo + 26), flip = _mm_set1_epi8(0x20);
+
+	for(; (uintptr_t)str % 16 != 0; str++) {
+		if(*str == '\0')
+			return;
+		else if((*str >= lo) && (*str <= lo + 25))
+			*str ^= 0x20;
+	}
+
+	while(true) {
+		v = _mm_load_si128((const __m128i *)str);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0)
+			break;
+
+		in = _mm_and_si128(_mm_cmpgt_epi8(v, min), _mm_cmplt_epi8(v, max));
+		_mm_store_si128((__m128i *)str, _mm_xor_si128(v, _mm_and_si128(in, flip)));
+		str += 16;
+	}
+
+	case_byte(str, lo);
+}
+
+/**
+ * Flip the case of the ASCII letters in a string using AVX2, 32 bytes at a
+ * time.
+ *   @str: The string.
+ *   @lo: The first letter to flip, either 'A' or 'a'.
+ */
+
+__attribute__((target("avx2")))
+static void case_avx2(char *str, char lo)
+{
+	__m256i v, in;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i min = _mm256_set1_epi8(lo - 1), max = _mm256_set1_epi8(lo + 26), flip = _mm256_set1_epi8(0x20);
+
+	for(; (uintptr_t)str % 32 != 0; str++) {
+		if(*str == '\0')
+			return;
+		else if((*str >= lo) && (*str <= lo + 25))
+			*str ^= 0x20;
+	}
+
+	while(true) {
+		v = _mm256_load_si256((const __m256i *)str);
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)) != 0)
+			break;
+
+		in = _mm256_and_si256(_mm256_cmpgt_epi8(v, min), _mm256_cmpgt_epi8(max, v));
+		_mm256_store_si256((__m256i *)str, _mm256_xor_si256(v, _mm256_and_si256(in, flip)));
+		str += 32;
+	}
+
+	case_byte(str, lo);
+}
+
+/**
+ * Fold the ASCII letters of a vector to lowercase.
+ *   @v: The vector.
+ *   &returns: The folded vector.
+ */
+
+static inline __m128i vec_lower(__m128i v)
+{
+	__m128i in;
+
+	in = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+
+	return _mm_or_si128(v, _mm_and_si128(in, _mm_set1_epi8(0x20)));
+}
+
+/**
+ * Check if a string starts with a prefix, ignoring ASCII case, sixteen
+ * bytes at a time where reads stay within a page.
+ *   @left: The string.
+ *   @right: The prefix.
+ *   &returns: The end of the prefix in the string, or null.
+ */
+
+static const char *prefixi_sse2(const char *left, const char *right)
+{
+	unsigned int end, diff;
+	__m128i l, r;
+
+	while(page_safe(left, 16) && page_safe(right, 16)) {
+		l = vec_lower(_mm_loadu_si128((const __m128i *)left));
+		r = vec_lower(_mm_loadu_si128((const __m128i *)right));
+
+		end = _mm_movemask_epi8(_mm_cmpeq_epi8(r, _mm_setzero_si128()));
+		diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) & 0xFFFF;
+
+		if(end != 0) {
+			end = __builtin_ctz(end);
+
+			return (diff & ((1u << end) - 1)) ? NULL : left + end;
+		}
+		else if(diff != 0)
+			return NULL;
+
+		left += 16;
+		right += 16;
+	}
+
+	return prefixi_word(left, right);
+}
+
+/**
+ * Find the whitespace and terminator bytes of a vector.
+ *   @v: The vector.
+ *   &returns: The mask of matching bytes.
+ */
+
+static inline __m128i vec_wbrk(__m128i v)
+{
+	__m128i ws;
+
+	ws = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1)));
+	ws = _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+
+	return _mm_or_si128(ws, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+
+/**
+ * Find the first whitespace in a string sixteen bytes at a time. Aligned
+ * loads never cross a page.
+ *   @str: The string.
+ *   &returns: The whitespace, or null if the string ends first.
+ */
+
+static const char *wbrk_sse2(const char *str)
+{
+	unsigned int mask, off;
+	const char *ptr;
+
+	off = (uintptr_t)str % 16;
+	ptr = str - off;
+	mask = _mm_movemask_epi8(vec_wbrk(_mm_load_si128((const __m128i *)ptr))) >> off << off;
+
+	while(mask == 0) {
+		ptr += 16;
+		mask = _mm_movemask_epi8(vec_wbrk(_mm_load_si128((const __m128i *)ptr)));
+	}
+
+	ptr += __builtin_ctz(mask);
+
+	return (*ptr == '\0') ? NULL : ptr;
+}
+
+/**
+ * Find the first whitespace in a string using AVX2, 32 bytes at a time.
+ *   @str: The string.
+ *   &returns: The whitespace, or null if the string ends first.
+ */
+
+__attribute__((target("avx2")))
+static const char *wbrk_avx2(const char *str)
+{
+	unsigned int mask, off;
+	const char *ptr;
+	__m256i v, ws;
+	const __m256i tab = _mm256_set1_epi8('\t' - 1), cr = _mm256_set1_epi8('\r' + 1), sp = _mm256_set1_epi8(' '), zero = _mm256_setzero_si256();
+
+	off = (uintptr_t)str % 32;
+	ptr = str - off;
+
+	for(mask = 0; ; ptr += 32) {
+		v = _mm256_load_si256((const __m256i *)ptr);
+		ws = _mm256_and_si256(_mm256_cmpgt_epi8(v, tab), _mm256_cmpgt_epi8(cr, v));
+		ws = _mm256_or_si256(ws, _mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, zero)));
+
+		mask = _mm256_movemask_epi8(ws);
+		if(off > 0) {
+			mask = mask >> off << off;
+			off = 0;
+		}
+
+		if(mask != 0)
+			break;
+	}
+
+	ptr += __builtin_ctz(mask);
+
+	return (*ptr == '\0') ? NULL : ptr;
+}
+
+/**
+ * Check if a buffer is all zero sixteen bytes at a time.
+ *   @ptr: The buffer.
+ *   @nbytes: The number of bytes.
+ *   &returns: True if all zero.
+ */
+
+static bool iszero_sse2(const void *ptr, size_t nbytes)
+{
+	size_t i;
+	__m128i acc = _mm_setzero_si128();
+
+	for(i = 0; i + 16 <= nbytes; i += 16) {
+		acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *)(ptr + i)));
+		if((i % 256 == 240) && (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF))
+			return false;
+	}
+
+	if(_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF)
+		return false;
+
+	return iszero_word(ptr + i, nbytes - i);
+}
+
+/**
+ * Check if a buffer is all zero using AVX2, 64 bytes at a time.
+ *   @ptr: The buffer.
+ *   @nbytes: The number of bytes.
+ *   &returns: True if all zero.
+ */
+
+__attribute__((target("avx2")))
+static bool iszero_avx2(const void *ptr, size_t nbytes)
+{
+	size_t i;
+	__m256i acc = _mm256_setzero_si256();
+
+	for(i = 0; i + 64 <= nbytes; i += 64) {
+		acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i *)(ptr + i)));
+		acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i *)(ptr + i + 32)));
+		if((i % 512 == 448) && !_mm256_testz_si256(acc, acc))
+			return false;
+	}
+
+	if(!_mm256_testz_si256(acc, acc))
+		return false;
+
+	return iszero_sse2(ptr + i, nbytes - i);
+}
+
+#endif
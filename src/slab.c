@@ -0,0 +1,634 @@
+#define _GNU_SOURCE
+#include "common.h"
+#include <sys/mman.h>
+#include "posix/inc.h"
+#include "try.h"
+
+#if _slab
+
+/*
+ * slab definitions
+ */
+
+#define SPAN_SIZE	((size_t)1 << 20)
+#define SPAN_HDR	64
+#define SPAN_LARGE	UINT32_MAX
+#define SPAN_ARENA	(UINT32_MAX - 1)
+#define SPAN_IDLE	16
+
+#define HUGE_SIZE	((size_t)2 << 20)
+
+#define NCLASS		44
+#define CLASS_MAX	65536
+
+/**
+ * Span structure. Spans are aligned to the span size so that the span of
+ * any object is found by masking its address. Large allocations receive
+ * their own span.
+ *   @next: The next span.
+ *   @cls: The size class, 'SPAN_LARGE' or 'SPAN_ARENA'.
+ *   @nbytes: The number of mapped bytes.
+ */
+
+struct span_t {
+	struct span_t *next;
+
+	uint32_t cls;
+	size_t nbytes;
+};
+
+/**
+ * Depot structure. The depot holds batches of free objects for a size class
+ * shared by all threads; the first word of each object links the batch and
+ * the second word of the first object links the next batch.
+ *   @lock: The lock.
+ *   @batch: The batch list.
+ *   @cur, end: The carving pointer and its limit.
+ */
+
+struct depot_t {
+	_mutex_t lock;
+
+	void **batch;
+	uint8_t *cur, *end;
+};
+
+/**
+ * Thread cache structure.
+ *   @list: The per-class free lists.
+ */
+
+struct cache_t {
+	struct {
+		void **head;
+		uint32_t cnt;
+	} list[NCLASS];
+};
+
+
+/*
+ * local function declarations
+ */
+
+static struct cache_t *cache_get(void);
+static void cache_delete(void *arg);
+static void *cache_refill(struct cache_t *cache, uint32_t cls);
+static void cache_flush(struct cache_t *cache, uint32_t cls, uint32_t cnt);
+
+static uint32_t class_index(size_t nbytes);
+static size_t class_size(uint32_t cls);
+static uint32_t class_batch(uint32_t cls);
+
+static struct span_t *span_map(size_t nbytes, uint32_t cls);
+static void *map_aligned(size_t nbytes, size_t align);
+static size_t large_round(size_t nbytes);
+static void *large_realloc(struct span_t *span, size_t nbytes);
+
+/*
+ * local variables
+ */
+
+static _specific_t specific;
+static __thread struct cache_t *current = NULL;
+static _mutex_t lock = _MUTEX_INIT;
+static struct span_t *spans = NULL;
+static struct span_t *idle = NULL;
+static uint32_t nidle = 0;
+static struct depot_t depot[NCLASS];
+
+
+/**
+ * Initialize the slab allocator.
+ */
+
+void _slab_init(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < NCLASS; i++) {
+		depot[i].lock = _mutex_init();
+		_mutex_name(&depot[i].lock, "slab.depot");
+		depot[i].batch = NULL;
+		depot[i].cur = depot[i].end = NULL;
+	}
+
+	specific = _specific_alloc(cache_delete);
+}
+
+/**
+ * Destroy the slab allocator, unmapping all spans.
+ */
+
+void _slab_destroy(void)
+{
+	uint32_t i;
+	struct span_t *span;
+
+	if(current != NULL)
+		free(current);
+
+	current = NULL;
+
+	_specific_free(specific);
+
+	for(i = 0; i < NCLASS; i++)
+		_mutex_destroy(&depot[i].lock);
+
+	while(spans != NULL) {
+		span = spans;
+		spans = span->next;
+		munmap(span, span->nbytes);
+	}
+
+	while(idle != NULL) {
+		span = idle;
+		idle = span->next;
+		munmap(span, span->nbytes);
+	}
+
+	nidle = 0;
+}
+
+
+/**
+ * Allocate memory from the slab allocator.
+ *   @nbytes: The number of bytes.
+ *   &returns: The allocated memory.
+ */
+
+void *_slab_alloc(size_t nbytes)
+{
+	void **obj;
+	uint32_t cls;
+	struct span_t *span;
+	struct cache_t *cache;
+
+	if(nbytes > CLASS_MAX) {
+		span = span_map(SPAN_HDR + nbytes, SPAN_LARGE);
+
+		return (void *)span + SPAN_HDR;
+	}
+
+	cls = class_index(nbytes);
+	cache = cache_get();
+
+	obj = cache->list[cls].head;
+	if(obj == NULL)
+		return cache_refill(cache, cls);
+
+	cache->list[cls].head = *obj;
+	cache->list[cls].cnt--;
+
+	return obj;
+}
+
+/**
+ * Reallocate memory from the slab allocator.
+ *   @ptr: The original pointer.
+ *   @nbytes: The number of bytes.
+ *   &returns: The new pointer.
+ */
+
+void *_slab_realloc(void *ptr, size_t nbytes)
+{
+	void *copy;
+	size_t size;
+
+	if(ptr == NULL)
+		return _slab_alloc(nbytes);
+
+	if((nbytes > CLASS_MAX) && (_slab_size(ptr) > CLASS_MAX))
+		return large_realloc((void *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SIZE - 1)), nbytes);
+
+	size = _slab_size(ptr);
+	if((nbytes <= size) && (nbytes >= size / 2))
+		return ptr;
+
+	copy = _slab_alloc(nbytes);
+	memcpy(copy, ptr, (size < nbytes) ? size : nbytes);
+	_slab_free(ptr);
+
+	return copy;
+}
+
+/**
+ * Free memory from the slab allocator. The object is placed on the thread
+ * cache of the caller, regardless of which thread allocated it.
+ *   @ptr: The pointer.
+ */
+
+void _slab_free(void *ptr)
+{
+	void **obj = ptr;
+	uint32_t cls;
+	struct span_t *span;
+	struct cache_t *cache;
+
+	span = (void *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SIZE - 1));
+	if(span->cls == SPAN_LARGE) {
+		munmap(span, span->nbytes);
+		return;
+	}
+
+	cls = span->cls;
+	cache = cache_get();
+
+	*obj = cache->list[cls].head;
+	cache->list[cls].head = obj;
+
+	if(++cache->list[cls].cnt >= 2 * class_batch(cls))
+		cache_flush(cache, cls, class_batch(cls));
+}
+
+/**
+ * Retrieve the usable size of slab memory.
+ *   @ptr: The pointer.
+ *   &returns: The number of usable bytes.
+ */
+
+size_t _slab_size(void *ptr)
+{
+	struct span_t *span;
+
+	span = (void *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SIZE - 1));
+
+	return (span->cls == SPAN_LARGE) ? (span->nbytes - SPAN_HDR) : class_size(span->cls);
+}
+
+/**
+ * Retrieve the usable size that an allocation of a given size receives.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of usable bytes.
+ */
+
+size_t _slab_round(size_t nbytes)
+{
+	return (nbytes > CLASS_MAX) ? (large_round(SPAN_HDR + nbytes) - SPAN_HDR) : class_size(class_index(nbytes));
+}
+
+
+/**
+ * Allocate an arena span. Memory inside an arena span is recognised by
+ * '_slab_isspan', letting arenas work without per-block tracking. Idle
+ * spans of the same mapped size are reused.
+ *   @nbytes: The number of bytes.
+ *   &returns: The span memory.
+ */
+
+void *_slab_span(size_t nbytes)
+{
+	size_t size;
+	struct span_t *span = NULL, **iter;
+
+	size = (SPAN_HDR + nbytes + 4095) & ~(size_t)4095;
+
+	if(size <= SPAN_SIZE) {
+		_mutex_lock(&lock);
+
+		for(iter = &idle; *iter != NULL; iter = &(*iter)->next) {
+			if((*iter)->nbytes == size) {
+				span = *iter;
+				*iter = span->next;
+				nidle--;
+				break;
+			}
+		}
+
+		_mutex_unlock(&lock);
+	}
+
+	if(span == NULL)
+		span = span_map(SPAN_HDR + nbytes, SPAN_ARENA);
+
+	return (void *)span + SPAN_HDR;
+}
+
+/**
+ * Release an arena span. A few spans no larger than the standard span are
+ * kept for reuse.
+ *   @ptr: The span memory.
+ */
+
+void _slab_unspan(void *ptr)
+{
+	struct span_t *span;
+
+	span = (void *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SIZE - 1));
+
+	if(span->nbytes <= SPAN_SIZE) {
+		_mutex_lock(&lock);
+
+		if(nidle < SPAN_IDLE) {
+			span->next = idle;
+			idle = span;
+			nidle++;
+			span = NULL;
+		}
+
+		_mutex_unlock(&lock);
+	}
+
+	if(span != NULL)
+		munmap(span, span->nbytes);
+}
+
+/**
+ * Check if memory belongs to an arena span.
+ *   @ptr: The pointer.
+ *   &returns: True if inside an arena span.
+ */
+
+bool _slab_isspan(void *ptr)
+{
+	struct span_t *span;
+
+	span = (void *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_SIZE - 1));
+
+	return span->cls == SPAN_ARENA;
+}
+
+
+/**
+ * Retrieve the cache for the current thread, creating it if needed. The
+ * thread-specific key only holds the cache so it is deleted at thread exit.
+ *   &returns: The cache.
+ */
+
+static struct cache_t *cache_get(void)
+{
+	if(current == NULL) {
+		current = calloc(1, sizeof(struct cache_t));
+		_specific_set(specific, current);
+	}
+
+	return current;
+}
+
+/**
+ * Delete a thread cache, returning its objects to the depot.
+ *   @arg: The cache.
+ */
+
+static void cache_delete(void *arg)
+{
+	uint32_t i;
+	struct cache_t *cache = arg;
+
+	for(i = 0; i < NCLASS; i++) {
+		if(cache->list[i].cnt > 0)
+			cache_flush(cache, i, cache->list[i].cnt);
+	}
+
+	if(current == cache)
+		current = NULL;
+
+	free(cache);
+}
+
+/**
+ * Refill a thread cache from the depot, carving new objects when the depot
+ * has no free batches.
+ *   @cache: The cache.
+ *   @cls: The size class.
+ *   &returns: An allocated object.
+ */
+
+static void *cache_refill(struct cache_t *cache, uint32_t cls)
+{
+	void **obj, **head;
+	uint32_t i, cnt;
+	size_t size;
+	struct span_t *span;
+	struct depot_t *dep = &depot[cls];
+
+	_mutex_lock(&dep->lock);
+
+	head = dep->batch;
+	if(head != NULL) {
+		dep->batch = head[1];
+		_mutex_unlock(&dep->lock);
+
+		for(cnt = 0, obj = *head; obj != NULL; obj = *obj)
+			cnt++;
+	}
+	else {
+		size = class_size(cls);
+		cnt = class_batch(cls);
+
+		for(i = 0; i <= cnt; i++) {
+			if(dep->cur + size > dep->end) {
+				span = span_map(SPAN_SIZE, cls);
+
+				dep->cur = (uint8_t *)span + SPAN_HDR;
+				dep->end = (uint8_t *)span + SPAN_SIZE;
+			}
+
+			obj = (void **)dep->cur;
+			dep->cur += size;
+
+			*obj = head;
+			head = obj;
+		}
+
+		_mutex_unlock(&dep->lock);
+	}
+
+	cache->list[cls].head = *head;
+	cache->list[cls].cnt = cnt;
+
+	return head;
+}
+
+/**
+ * Flush objects from a thread cache into the depot as a single batch.
+ *   @cache: The cache.
+ *   @cls: The size class.
+ *   @cnt: The number of objects, at most the number of cached objects.
+ */
+
+static void cache_flush(struct cache_t *cache, uint32_t cls, uint32_t cnt)
+{
+	void **head, **tail;
+	uint32_t i;
+	struct depot_t *dep = &depot[cls];
+
+	head = tail = cache->list[cls].head;
+	for(i = 1; i < cnt; i++)
+		tail = *tail;
+
+	cache->list[cls].head = *tail;
+	cache->list[cls].cnt -= cnt;
+	*tail = NULL;
+
+	_mutex_lock(&dep->lock);
+	head[1] = dep->batch;
+	dep->batch = head;
+	_mutex_unlock(&dep->lock);
+}
+
+
+/**
+ * Compute the size class for a number of bytes. Classes are spaced by
+ * sixteen bytes up to 128 and then by four steps per power of two.
+ *   @nbytes: The number of bytes, at most 'CLASS_MAX'.
+ *   &returns: The size class.
+ */
+
+static uint32_t class_index(size_t nbytes)
+{
+	uint32_t bit;
+
+	if(nbytes <= 128)
+		return (nbytes > 0) ? ((nbytes - 1) / 16) : 0;
+
+	nbytes--;
+	bit = 63 - __builtin_clzl(nbytes);
+
+	return 8 + 4 * (bit - 7) + (nbytes >> (bit - 2)) - 4;
+}
+
+/**
+ * Retrieve the object size of a size class.
+ *   @cls: The size class.
+ *   &returns: The size in bytes.
+ */
+
+static size_t class_size(uint32_t cls)
+{
+	if(cls < 8)
+		return 16 * (cls + 1);
+
+	cls -= 8;
+
+	return (size_t)(5 + cls % 4) << (5 + cls / 4);
+}
+
+/**
+ * Retrieve the number of objects moved between a thread cache and the depot
+ * at once.
+ *   @cls: The size class.
+ *   &returns: The batch size.
+ */
+
+static uint32_t class_batch(uint32_t cls)
+{
+	size_t cnt = 32768 / class_size(cls);
+
+	return (cnt < 4) ? 4 : (cnt > 64) ? 64 : cnt;
+}
+
+
+/**
+ * Map a span aligned to the span size. Class spans are recorded so that
+ * they can be unmapped when the allocator is destroyed. Large spans of at
+ * least 'HUGE_SIZE' are aligned and sized for transparent huge pages.
+ *   @nbytes: The number of bytes.
+ *   @cls: The size class, 'SPAN_LARGE' or 'SPAN_ARENA'.
+ *   &returns: The span.
+ */
+
+static struct span_t *span_map(size_t nbytes, uint32_t cls)
+{
+	struct span_t *span;
+
+	if(cls == SPAN_LARGE)
+		nbytes = large_round(nbytes);
+	else
+		nbytes = (nbytes + 4095) & ~(size_t)4095;
+
+	span = map_aligned(nbytes, (nbytes >= HUGE_SIZE) ? HUGE_SIZE : SPAN_SIZE);
+	span->cls = cls;
+	span->nbytes = nbytes;
+
+	if(cls < NCLASS) {
+		_mutex_lock(&lock);
+		span->next = spans;
+		spans = span;
+		_mutex_unlock(&lock);
+	}
+
+	return span;
+}
+
+/**
+ * Map memory with a given alignment. Regions of at least 'HUGE_SIZE' are
+ * advised to use transparent huge pages.
+ *   @nbytes: The number of bytes, a multiple of the page size.
+ *   @align: The power-of-two alignment.
+ *   &returns: The mapped memory.
+ */
+
+static void *map_aligned(size_t nbytes, size_t align)
+{
+	uint8_t *map, *base;
+
+	map = mmap(NULL, nbytes + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(map == MAP_FAILED)
+		fatal("Failed to map memory. %s.", strerror(errno));
+
+	base = (uint8_t *)(((uintptr_t)map + align - 1) & ~(uintptr_t)(align - 1));
+	if(base > map)
+		munmap(map, base - map);
+
+	munmap(base + nbytes, map + align - base);
+
+#ifdef MADV_HUGEPAGE
+	if(nbytes >= HUGE_SIZE)
+		madvise(base, nbytes, MADV_HUGEPAGE);
+#endif
+
+	return base;
+}
+
+/**
+ * Round the size of a large span. Sizes from 'HUGE_SIZE' upwards are
+ * rounded to whole huge pages.
+ *   @nbytes: The number of bytes.
+ *   &returns: The rounded size.
+ */
+
+static size_t large_round(size_t nbytes)
+{
+	if(nbytes >= HUGE_SIZE)
+		return (nbytes + HUGE_SIZE - 1) & ~(HUGE_SIZE - 1);
+	else
+		return (nbytes + 4095) & ~(size_t)4095;
+}
+
+/**
+ * Resize a large span without copying. The span is grown in place when
+ * possible, otherwise its pages are moved to a new aligned address.
+ *   @span: The span.
+ *   @nbytes: The number of usable bytes.
+ *   &returns: The memory.
+ */
+
+static void *large_realloc(struct span_t *span, size_t nbytes)
+{
+	void *dest;
+	size_t size;
+
+	size = large_round(SPAN_HDR + nbytes);
+	if(size < span->nbytes)
+		munmap((void *)span + size, span->nbytes - size);
+	else if(size > span->nbytes) {
+		if(mremap(span, span->nbytes, size, 0) == MAP_FAILED) {
+			dest = map_aligned(size, (size >= HUGE_SIZE) ? HUGE_SIZE : SPAN_SIZE);
+			if(mremap(span, span->nbytes, size, MREMAP_MAYMOVE | MREMAP_FIXED, dest) == MAP_FAILED)
+				fatal("Failed to remap memory. %s.", strerror(errno));
+
+			span = dest;
+		}
+
+#ifdef MADV_HUGEPAGE
+		if(size >= HUGE_SIZE)
+			madvise(span, size, MADV_HUGEPAGE);
+#endif
+	}
+
+	span->nbytes = size;
+
+	return (void *)span + SPAN_HDR;
+}
+
+#endif
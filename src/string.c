@@ -45,7 +45,7 @@ static size_t output_write(struct output_t *output, void *restrict buf, size_t n
 _export
 size_t str_len(const char *str)
 {
-	return strlen(str);
+	return __builtin_strlen(str);
 }
 
 /**
@@ -73,7 +73,7 @@ char *str_rchr(const char *str, char ch)
 }
 
 /**
- * String break on whitespace.
+ * String break on whitespace. Whitespace is taken from the C locale.
  *   @str: The string.
  *   &returns: The first whitespace character or null.
  */
@@ -81,14 +81,7 @@ char *str_rchr(const char *str, char ch)
 _export
 char *str_wbrk(const char *str)
 {
-	while(!str_isspace(*str)) {
-		if(*str == '\0')
-			return NULL;
-
-		str++;
-	}
-
-	return (char *)str;
+	return (char *)_simd_wbrk(str);
 }
 
 
@@ -169,16 +162,7 @@ char *str_prefix(const char *left, const char *right)
 _export
 char *str_prefixi(const char *left, const char *right)
 {
-	while(true) {
-		if(ch_tolower(*right) == '\0')
-			return (char *)left;
-
-		if(ch_tolower(*left) != ch_tolower(*right))
-			return NULL;
-
-		left++;
-		right++;
-	}
+	return (char *)_simd_prefixi(left, right);
 }
 
 
@@ -278,8 +262,7 @@ bool str_isalnum(char ch)
 _export
 void str_tolower(char *str)
 {
-	while(*str != '\0')
-		*str = ch_tolower(*str);
+	_simd_case(str, 'A');
 }
 
 /**
@@ -290,8 +273,7 @@ void str_tolower(char *str)
 _export
 void str_toupper(char *str)
 {
-	while(*str != '\0')
-		*str = ch_toupper(*str);
+	_simd_case(str, 'a');
 }
 
 
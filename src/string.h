@@ -10,9 +10,9 @@
  * string function declarations
  */
 
-size_t str_len(const char *str);
 char *str_chr(const char *str, char ch);
 char *str_rchr(const char *str, char ch);
+char *str_wbrk(const char *str);
 
 bool str_isequal(const char *left, const char *right);
 int str_cmp(const char *left, const char *right);
@@ -80,6 +80,17 @@ double str_scan_double(const char *str, char **endptr);
 unsigned int str_read_uint(const char *str, char **endptr);
 double str_read_double(const char *str, char **endptr);
 
+/**
+ * Retrieve the string length.
+ *   @str: The string.
+ *   &returns: The length.
+ */
+
+_inline size_t str_len(const char *str)
+{
+	return __builtin_strlen(str);
+}
+
 /**
  * Retrieve the last character of a string.
  *   &returns: The last character or null on a zero length string.
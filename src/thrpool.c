@@ -0,0 +1,769 @@
+#include "common.h"
+#include "thrpool.h"
+#include "mem.h"
+#include "posix/inc.h"
+#include "res.h"
+#include "string.h"
+#include "try.h"
+
+
+/*
+ * thread pool definitions
+ */
+
+#define THRPOOL_LINE	64
+#define THRPOOL_RING	256
+#define THRPOOL_SPIN	64
+
+/**
+ * Task structure.
+ *   @pool: The pool.
+ *   @next: The next task in the submission queue.
+ *   @func: The function.
+ *   @arg, ret: The argument and return value.
+ *   @error: The error thrown by the function, if any.
+ *   @detach, done: The detached and completion flags.
+ */
+
+struct thrtask_t {
+	struct thrpool_t *pool;
+	struct thrtask_t *next;
+
+	void *(*func)(void *);
+	void *arg, *ret;
+
+	char *error;
+	bool detach, done;
+};
+
+/**
+ * Ring structure. Replaced rings are kept until the pool is deleted, since
+ * a thief may still be reading from them.
+ *   @old: The replaced ring.
+ *   @mask: The index mask.
+ *   @slot: The task slots.
+ */
+
+struct ring_t {
+	struct ring_t *old;
+	int64_t mask;
+	struct thrtask_t *slot[];
+};
+
+/**
+ * Work-stealing deque structure. The owner pushes and pops at the bottom,
+ * while thieves steal from the top.
+ *   @top, bottom: The top and bottom indices.
+ *   @ring: The ring.
+ */
+
+struct deque_t {
+	int64_t top __attribute__((aligned(THRPOOL_LINE)));
+	int64_t bottom __attribute__((aligned(THRPOOL_LINE)));
+	struct ring_t *ring;
+};
+
+/**
+ * Worker structure.
+ *   @deque: The deque.
+ *   @pool: The pool.
+ *   @thread: The thread.
+ *   @seed: The victim selection state.
+ */
+
+struct worker_t {
+	struct deque_t deque;
+
+	struct thrpool_t *pool;
+	_thread_t thread;
+	uint64_t seed;
+} __attribute__((aligned(THRPOOL_LINE)));
+
+/**
+ * Thread pool structure.
+ *   @nthreads: The number of workers.
+ *   @worker: The worker array.
+ *   @lock: The lock.
+ *   @idle, wait: The idle worker and external waiter conditions.
+ *   @head, tail: The submission queue for tasks from outside the pool.
+ *   @queued: The number of tasks not yet taken.
+ *   @nsleep, nwait: The number of sleeping workers and external waiters.
+ *   @stop: The stop flag.
+ */
+
+struct thrpool_t {
+	unsigned int nthreads;
+	struct worker_t *worker;
+
+	_mutex_t lock;
+	_cond_t idle, wait;
+	struct thrtask_t *head, **tail;
+
+	int64_t queued;
+	unsigned int nsleep, nwait;
+	bool stop;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static struct thrpool_t *pool_new(unsigned int nthreads, const struct _topo_t *topo);
+
+static void *worker_proc(void *arg);
+static struct thrtask_t *worker_next(struct worker_t *worker);
+
+static struct thrtask_t *task_submit(struct thrpool_t *pool, void *(*func)(void *), void *arg, bool detach);
+static struct thrtask_t *task_find(struct thrpool_t *pool, struct worker_t *worker);
+static void task_run(struct thrtask_t *task);
+
+static struct thrtask_t *queue_take(struct thrpool_t *pool);
+
+static void deque_init(struct deque_t *deque);
+static void deque_destroy(struct deque_t *deque);
+static void deque_push(struct deque_t *deque, struct thrtask_t *task);
+static struct thrtask_t *deque_pop(struct deque_t *deque);
+static struct thrtask_t *deque_steal(struct deque_t *deque);
+
+/*
+ * local variables
+ */
+
+static __thread struct worker_t *self = NULL;
+
+static _mutex_t global_lock = _MUTEX_INIT;
+static struct thrpool_t *global = NULL;
+
+
+/**
+ * Destroy the global thread pool, if created.
+ */
+
+void _thrpool_destroy(void)
+{
+	if(global != NULL)
+		thrpool_delete(global);
+
+	global = NULL;
+}
+
+
+/**
+ * Create a thread pool. Each worker runs in its own resource scope.
+ *   @nthreads: The number of workers, or zero for one per processor.
+ *   &returns: The pool.
+ */
+
+_export
+struct thrpool_t *thrpool_new(unsigned int nthreads)
+{
+	if(nthreads == 0)
+		nthreads = _thread_ncpus();
+
+	return pool_new(nthreads, NULL);
+}
+
+/**
+ * Create a thread pool with one worker pinned to each physical core. Each
+ * worker prefers memory from the NUMA node of its core.
+ *   &returns: The pool.
+ */
+
+_export
+struct thrpool_t *thrpool_new_pinned(void)
+{
+	struct _topo_t topo;
+	struct thrpool_t *pool;
+
+	topo = _topo_query();
+	pool = pool_new(topo.ncores, &topo);
+	_topo_destroy(&topo);
+
+	return pool;
+}
+
+/**
+ * Delete a thread pool. Tasks already submitted are run before the workers
+ * exit.
+ *   @pool: The pool.
+ */
+
+_export
+void thrpool_delete(struct thrpool_t *pool)
+{
+	unsigned int i;
+
+	_mutex_lock(&pool->lock);
+	pool->stop = true;
+	_cond_broadcast(&pool->idle);
+	_mutex_unlock(&pool->lock);
+
+	for(i = 0; i < pool->nthreads; i++)
+		_thread_join(pool->worker[i].thread);
+
+	for(i = 0; i < pool->nthreads; i++)
+		deque_destroy(&pool->worker[i].deque);
+
+	_cond_destroy(&pool->wait);
+	_cond_destroy(&pool->idle);
+	_mutex_destroy(&pool->lock);
+	free(pool->worker);
+	free(pool);
+}
+
+
+/**
+ * Submit a task to the pool. Tasks submitted from a worker of the same pool
+ * go onto that worker's deque, where idle workers may steal them. Every task
+ * must be waited on with 'thrpool_wait'.
+ *   @pool: The pool.
+ *   @func: The function.
+ *   @arg: The argument.
+ *   &returns: The task.
+ */
+
+_export
+struct thrtask_t *thrpool_submit(struct thrpool_t *pool, void *(*func)(void *), void *arg)
+{
+	return task_submit(pool, func, arg, false);
+}
+
+/**
+ * Submit a detached task to the pool. The task is released once it has
+ * run, and an error thrown by it is fatal.
+ *   @pool: The pool.
+ *   @func: The function.
+ *   @arg: The argument.
+ */
+
+_export
+void thrpool_spawn(struct thrpool_t *pool, void *(*func)(void *), void *arg)
+{
+	task_submit(pool, func, arg, true);
+}
+
+/**
+ * Wait for a task to complete and release it. A worker of the same pool
+ * runs other tasks while it waits. If the task threw, the error is thrown
+ * again in the waiting thread.
+ *   @task: The task.
+ *   &returns: The value returned by the task.
+ */
+
+_export
+void *thrpool_wait(struct thrtask_t *task)
+{
+	void *ret;
+	char *error;
+
+	error = _thrpool_join(task, &ret);
+	if(error != NULL) {
+		char msg[str_len(error) + 1];
+
+		mem_copy(msg, error, sizeof(msg));
+		free(error);
+
+		throw("%s", msg);
+	}
+
+	return ret;
+}
+
+/**
+ * Wait for a task to complete and release it without throwing.
+ *   @task: The task.
+ *   @ret: Out. The value returned by the task.
+ *   &returns: The error thrown by the task, freed with 'free', or null.
+ */
+
+char *_thrpool_join(struct thrtask_t *task, void **ret)
+{
+	char *error;
+	struct thrpool_t *pool = task->pool;
+
+	if((self != NULL) && (self->pool == pool)) {
+		while(!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+			if(!_thrpool_help())
+				_thread_yield();
+		}
+	}
+	else if(!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+		_mutex_lock(&pool->lock);
+		__atomic_add_fetch(&pool->nwait, 1, __ATOMIC_SEQ_CST);
+
+		while(!__atomic_load_n(&task->done, __ATOMIC_SEQ_CST))
+			_cond_wait(&pool->wait, &pool->lock);
+
+		__atomic_sub_fetch(&pool->nwait, 1, __ATOMIC_SEQ_CST);
+		_mutex_unlock(&pool->lock);
+	}
+
+	*ret = task->ret;
+	error = task->error;
+	_slab_free(task);
+
+	return error;
+}
+
+
+/**
+ * Run one pending task of the calling worker's pool.
+ *   &returns: True if a task was run, false if none was found or the caller
+ *     is not a worker.
+ */
+
+bool _thrpool_help(void)
+{
+	struct thrtask_t *task;
+
+	if(self == NULL)
+		return false;
+
+	task = task_find(self->pool, self);
+	if(task == NULL)
+		return false;
+
+	task_run(task);
+
+	return true;
+}
+
+
+/**
+ * Retrieve the pool of the calling worker.
+ *   &returns: The pool, or null if not called from a worker.
+ */
+
+_export
+struct thrpool_t *thrpool_current(void)
+{
+	return self ? self->pool : NULL;
+}
+
+/**
+ * Retrieve the global pool, creating it with one worker per processor on
+ * first use.
+ *   &returns: The pool.
+ */
+
+_export
+struct thrpool_t *thrpool_global(void)
+{
+	struct thrpool_t *pool;
+
+	pool = __atomic_load_n(&global, __ATOMIC_ACQUIRE);
+	if(pool != NULL)
+		return pool;
+
+	_mutex_lock(&global_lock);
+
+	if(global == NULL)
+		__atomic_store_n(&global, thrpool_new(0), __ATOMIC_RELEASE);
+
+	pool = global;
+	_mutex_unlock(&global_lock);
+
+	return pool;
+}
+
+/**
+ * Retrieve the number of workers in a pool.
+ *   @pool: The pool.
+ *   &returns: The number of workers.
+ */
+
+_export
+unsigned int thrpool_size(struct thrpool_t *pool)
+{
+	return pool->nthreads;
+}
+
+
+/**
+ * Create a thread pool.
+ *   @nthreads: The number of workers.
+ *   @topo: Optional. The topology, pinning each worker to the first
+ *     processor of a physical core.
+ *   &returns: The pool.
+ */
+
+static struct thrpool_t *pool_new(unsigned int nthreads, const struct _topo_t *topo)
+{
+	unsigned int i, k = 0;
+	struct thrpool_t *pool;
+	struct _thrattr_t attr;
+
+	pool = malloc(sizeof(struct thrpool_t));
+	pool->nthreads = nthreads;
+	pool->worker = aligned_alloc(THRPOOL_LINE, nthreads * sizeof(struct worker_t));
+	pool->lock = _mutex_init();
+	_mutex_name(&pool->lock, "thrpool");
+	pool->idle = _cond_init();
+	pool->wait = _cond_init();
+	pool->head = NULL;
+	pool->tail = &pool->head;
+	pool->queued = 0;
+	pool->nsleep = pool->nwait = 0;
+	pool->stop = false;
+
+	for(i = 0; i < nthreads; i++) {
+		deque_init(&pool->worker[i].deque);
+		pool->worker[i].pool = pool;
+		pool->worker[i].seed = (i + 1) * 0x9E3779B97F4A7C15ull;
+	}
+
+	attr = _thrattr_init();
+	attr.name = "thrpool";
+
+	for(i = 0; i < nthreads; i++) {
+		if(topo != NULL) {
+			while(!topo->cpu[k].primary)
+				k++;
+
+			attr.cpus = &topo->cpu[k].id;
+			attr.ncpus = 1;
+			attr.node = (topo->nnodes > 1) ? (int)topo->cpu[k].node : -1;
+			k++;
+		}
+
+		pool->worker[i].thread = _thread_new_attr(worker_proc, &pool->worker[i], &attr);
+	}
+
+	return pool;
+}
+
+/**
+ * Worker thread function.
+ *   @arg: The worker.
+ *   &returns: Always null.
+ */
+
+static void *worker_proc(void *arg)
+{
+	struct thrtask_t *task;
+
+	self = arg;
+
+	while((task = worker_next(self)) != NULL)
+		task_run(task);
+
+	self = NULL;
+
+	return NULL;
+}
+
+/**
+ * Retrieve the next task for a worker, sleeping while there is none.
+ *   @worker: The worker.
+ *   &returns: The task, or null if the pool is stopping.
+ */
+
+static struct thrtask_t *worker_next(struct worker_t *worker)
+{
+	unsigned int i;
+	struct thrtask_t *task;
+	struct thrpool_t *pool = worker->pool;
+
+	while(true) {
+		for(i = 0; i < THRPOOL_SPIN; i++) {
+			task = task_find(pool, worker);
+			if(task != NULL)
+				return task;
+
+			_thread_yield();
+		}
+
+		_mutex_lock(&pool->lock);
+		__atomic_add_fetch(&pool->nsleep, 1, __ATOMIC_SEQ_CST);
+
+		while((__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) <= 0) && !pool->stop)
+			_cond_wait(&pool->idle, &pool->lock);
+
+		__atomic_sub_fetch(&pool->nsleep, 1, __ATOMIC_SEQ_CST);
+
+		if(pool->stop && (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) <= 0)) {
+			_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+
+		_mutex_unlock(&pool->lock);
+	}
+}
+
+
+/**
+ * Create a task and queue it.
+ *   @pool: The pool.
+ *   @func: The function.
+ *   @arg: The argument.
+ *   @detach: The detached flag.
+ *   &returns: The task.
+ */
+
+static struct thrtask_t *task_submit(struct thrpool_t *pool, void *(*func)(void *), void *arg, bool detach)
+{
+	struct thrtask_t *task;
+
+	task = _slab_alloc(sizeof(struct thrtask_t));
+	*task = (struct thrtask_t){ pool, NULL, func, arg, NULL, NULL, detach, false };
+
+	if((self != NULL) && (self->pool == pool)) {
+		deque_push(&self->deque, task);
+		__atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+		if(__atomic_load_n(&pool->nsleep, __ATOMIC_SEQ_CST) > 0) {
+			_mutex_lock(&pool->lock);
+			_cond_signal(&pool->idle);
+			_mutex_unlock(&pool->lock);
+		}
+	}
+	else {
+		_mutex_lock(&pool->lock);
+
+		*pool->tail = task;
+		pool->tail = &task->next;
+		__atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+		if(pool->nsleep > 0)
+			_cond_signal(&pool->idle);
+
+		_mutex_unlock(&pool->lock);
+	}
+
+	return task;
+}
+
+/**
+ * Find a task to run, first from the worker's own deque, then from the
+ * submission queue, and finally by stealing from another worker.
+ *   @pool: The pool.
+ *   @worker: The worker.
+ *   &returns: The task or null.
+ */
+
+static struct thrtask_t *task_find(struct thrpool_t *pool, struct worker_t *worker)
+{
+	unsigned int i, n;
+	uint64_t x;
+	struct thrtask_t *task;
+
+	task = deque_pop(&worker->deque);
+	if(task == NULL)
+		task = queue_take(pool);
+
+	if(task == NULL) {
+		x = worker->seed;
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		worker->seed = x;
+
+		n = (x * 0x2545F4914F6CDD1Dull) >> 32;
+		for(i = 0; (i < pool->nthreads) && (task == NULL); i++) {
+			if(&pool->worker[(n + i) % pool->nthreads] != worker)
+				task = deque_steal(&pool->worker[(n + i) % pool->nthreads].deque);
+		}
+	}
+
+	if(task != NULL)
+		__atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+	return task;
+}
+
+/**
+ * Run a task, capturing any error it throws. The try state of the worker
+ * is preserved, since tasks run nested while a worker waits.
+ *   @task: The task.
+ */
+
+static void task_run(struct thrtask_t *task)
+{
+	bool isfatal;
+	jmp_buf jmpbuf;
+	struct res_info_t *info = res_info();
+	struct thrpool_t *pool = task->pool;
+
+	isfatal = info->fatal;
+	mem_copy(&jmpbuf, &info->jmpbuf, sizeof(jmp_buf));
+
+	if(try())
+		task->ret = task->func(task->arg);
+	else {
+		const char *error = errstr;
+
+		task->error = malloc(str_len(error) + 1);
+		mem_copy(task->error, error, str_len(error) + 1);
+	}
+
+	mem_copy(&info->jmpbuf, &jmpbuf, sizeof(jmp_buf));
+	info->fatal = isfatal;
+
+	if(task->detach) {
+		if(task->error != NULL)
+			fatal("%s", task->error);
+
+		_slab_free(task);
+		return;
+	}
+
+	__atomic_store_n(&task->done, true, __ATOMIC_SEQ_CST);
+
+	if(__atomic_load_n(&pool->nwait, __ATOMIC_SEQ_CST) > 0) {
+		_mutex_lock(&pool->lock);
+		_cond_broadcast(&pool->wait);
+		_mutex_unlock(&pool->lock);
+	}
+}
+
+
+/**
+ * Take a task from the submission queue.
+ *   @pool: The pool.
+ *   &returns: The task or null.
+ */
+
+static struct thrtask_t *queue_take(struct thrpool_t *pool)
+{
+	struct thrtask_t *task;
+
+	if(__atomic_load_n(&pool->head, __ATOMIC_RELAXED) == NULL)
+		return NULL;
+
+	_mutex_lock(&pool->lock);
+
+	task = pool->head;
+	if(task != NULL) {
+		pool->head = task->next;
+		if(pool->head == NULL)
+			pool->tail = &pool->head;
+	}
+
+	_mutex_unlock(&pool->lock);
+
+	return task;
+}
+
+
+/**
+ * Initialize a deque.
+ *   @deque: The deque.
+ */
+
+static void deque_init(struct deque_t *deque)
+{
+	deque->top = deque->bottom = 0;
+	deque->ring = malloc(sizeof(struct ring_t) + THRPOOL_RING * sizeof(struct thrtask_t *));
+	deque->ring->old = NULL;
+	deque->ring->mask = THRPOOL_RING - 1;
+}
+
+/**
+ * Destroy a deque along with its replaced rings.
+ *   @deque: The deque.
+ */
+
+static void deque_destroy(struct deque_t *deque)
+{
+	struct ring_t *ring;
+
+	while(deque->ring != NULL) {
+		ring = deque->ring;
+		deque->ring = ring->old;
+		free(ring);
+	}
+}
+
+/**
+ * Push a task onto the bottom of a deque. Only the owner may push.
+ *   @deque: The deque.
+ *   @task: The task.
+ */
+
+static void deque_push(struct deque_t *deque, struct thrtask_t *task)
+{
+	int64_t i, top, bottom;
+	struct ring_t *ring, *grow;
+
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	ring = __atomic_load_n(&deque->ring, __ATOMIC_RELAXED);
+
+	if(bottom - top > ring->mask) {
+		grow = malloc(sizeof(struct ring_t) + 2 * (ring->mask + 1) * sizeof(struct thrtask_t *));
+		grow->old = ring;
+		grow->mask = 2 * ring->mask + 1;
+
+		for(i = top; i < bottom; i++)
+			grow->slot[i & grow->mask] = __atomic_load_n(&ring->slot[i & ring->mask], __ATOMIC_RELAXED);
+
+		__atomic_store_n(&deque->ring, grow, __ATOMIC_RELEASE);
+		ring = grow;
+	}
+
+	__atomic_store_n(&ring->slot[bottom & ring->mask], task, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Pop a task from the bottom of a deque. Only the owner may pop.
+ *   @deque: The deque.
+ *   &returns: The task or null.
+ */
+
+static struct thrtask_t *deque_pop(struct deque_t *deque)
+{
+	int64_t top, bottom;
+	struct ring_t *ring;
+	struct thrtask_t *task;
+
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	ring = __atomic_load_n(&deque->ring, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	if(top > bottom) {
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	task = __atomic_load_n(&ring->slot[bottom & ring->mask], __ATOMIC_RELAXED);
+	if(top == bottom) {
+		if(!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			task = NULL;
+
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return task;
+}
+
+/**
+ * Steal a task from the top of a deque.
+ *   @deque: The deque.
+ *   &returns: The task, or null if empty or lost to another thief.
+ */
+
+static struct thrtask_t *deque_steal(struct deque_t *deque)
+{
+	int64_t top, bottom;
+	struct ring_t *ring;
+	struct thrtask_t *task;
+
+	top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+	if(top >= bottom)
+		return NULL;
+
+	ring = __atomic_load_n(&deque->ring, __ATOMIC_ACQUIRE);
+	task = __atomic_load_n(&ring->slot[top & ring->mask], __ATOMIC_RELAXED);
+	if(!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return NULL;
+
+	return task;
+}
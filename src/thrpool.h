@@ -0,0 +1,20 @@
+#ifndef THRPOOL_H
+#define THRPOOL_H
+
+/*
+ * thread pool function declarations
+ */
+
+struct thrpool_t *thrpool_new(unsigned int nthreads);
+struct thrpool_t *thrpool_new_pinned(void);
+void thrpool_delete(struct thrpool_t *pool);
+
+struct thrtask_t *thrpool_submit(struct thrpool_t *pool, void *(*func)(void *), void *arg);
+void thrpool_spawn(struct thrpool_t *pool, void *(*func)(void *), void *arg);
+void *thrpool_wait(struct thrtask_t *task);
+
+struct thrpool_t *thrpool_current(void);
+struct thrpool_t *thrpool_global(void);
+unsigned int thrpool_size(struct thrpool_t *pool);
+
+#endif
@@ -0,0 +1,155 @@
+#include "common.h"
+#include "timefmt.h"
+#include <time.h>
+
+
+/*
+ * local function declarations
+ */
+
+static int64_t floordiv(int64_t val, int64_t div);
+static void digits(char *str, unsigned int val, unsigned int n);
+
+
+/**
+ * Initialize a timestamp formatter.
+ *   &returns: The formatter.
+ */
+
+_export
+struct timefmt_t timefmt_init(void)
+{
+	struct timefmt_t fmt;
+
+	fmt.isosec = fmt.epochsec = INT64_MIN;
+	fmt.epochlen = 0;
+	fmt.iso[0] = fmt.epoch[0] = '\0';
+
+	return fmt;
+}
+
+
+/**
+ * Format a realtime clock value as an ISO-8601 UTC timestamp with
+ * millisecond precision, such as '2024-01-31T12:34:56.789Z'. The date is
+ * only recomputed when the minute changes.
+ *   @fmt: The formatter.
+ *   @ns: The time in nanoseconds since 1970.
+ *   &returns: The formatted string, valid until the next call.
+ */
+
+_export
+const char *timefmt_iso8601(struct timefmt_t *fmt, int64_t ns)
+{
+	int64_t sec;
+
+	sec = floordiv(ns, 1000000000);
+
+	if(sec != fmt->isosec) {
+		if((fmt->isosec != INT64_MIN) && (floordiv(sec, 60) == floordiv(fmt->isosec, 60)))
+			digits(fmt->iso + 17, sec - 60 * floordiv(sec, 60), 2);
+		else {
+			struct tm tm;
+			time_t t = sec;
+
+			gmtime_r(&t, &tm);
+
+			digits(fmt->iso + 0, tm.tm_year + 1900, 4);
+			fmt->iso[4] = '-';
+			digits(fmt->iso + 5, tm.tm_mon + 1, 2);
+			fmt->iso[7] = '-';
+			digits(fmt->iso + 8, tm.tm_mday, 2);
+			fmt->iso[10] = 'T';
+			digits(fmt->iso + 11, tm.tm_hour, 2);
+			fmt->iso[13] = ':';
+			digits(fmt->iso + 14, tm.tm_min, 2);
+			fmt->iso[16] = ':';
+			digits(fmt->iso + 17, tm.tm_sec, 2);
+			fmt->iso[19] = '.';
+			fmt->iso[23] = 'Z';
+			fmt->iso[24] = '\0';
+		}
+
+		fmt->isosec = sec;
+	}
+
+	digits(fmt->iso + 20, (ns - 1000000000 * sec) / 1000000, 3);
+
+	return fmt->iso;
+}
+
+/**
+ * Format a realtime clock value as milliseconds since 1970. Only the digits
+ * that changed since the previous second are rewritten.
+ *   @fmt: The formatter.
+ *   @ns: The time in nanoseconds since 1970. Negative times are clamped to
+ *     zero.
+ *   &returns: The formatted string, valid until the next call.
+ */
+
+_export
+const char *timefmt_epochms(struct timefmt_t *fmt, int64_t ns)
+{
+	int64_t sec;
+	uint64_t val, prev;
+	uint8_t i, len;
+
+	if(ns < 0)
+		ns = 0;
+
+	sec = ns / 1000000000;
+
+	if(sec != fmt->epochsec) {
+		len = 0;
+		val = sec;
+		do
+			len++;
+		while((val /= 10) > 0);
+
+		val = sec;
+		prev = fmt->epochsec;
+
+		if((fmt->epochsec < 0) || (len != fmt->epochlen)) {
+			fmt->epoch[len + 3] = '\0';
+			fmt->epochlen = len;
+			prev = UINT64_MAX;
+		}
+
+		for(i = len; (i > 0) && (val != prev); val /= 10, prev /= 10)
+			fmt->epoch[--i] = '0' + val % 10;
+
+		fmt->epochsec = sec;
+	}
+
+	digits(fmt->epoch + fmt->epochlen, (ns % 1000000000) / 1000000, 3);
+
+	return fmt->epoch;
+}
+
+
+/**
+ * Divide rounding towards negative infinity.
+ *   @val: The value.
+ *   @div: The positive divisor.
+ *   &returns: The quotient.
+ */
+
+static int64_t floordiv(int64_t val, int64_t div)
+{
+	return (val >= 0) ? (val / div) : -((-val + div - 1) / div);
+}
+
+/**
+ * Write a fixed number of zero-padded decimal digits.
+ *   @str: The destination.
+ *   @val: The value.
+ *   @n: The number of digits.
+ */
+
+static void digits(char *str, unsigned int val, unsigned int n)
+{
+	while(n-- > 0) {
+		str[n] = '0' + val % 10;
+		val /= 10;
+	}
+}
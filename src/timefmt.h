@@ -0,0 +1,30 @@
+#ifndef TIMEFMT_H
+#define TIMEFMT_H
+
+/**
+ * Cached timestamp formatter structure. The formatter keeps the last
+ * formatted second so that only the changed suffix is rewritten. It is not
+ * thread-safe; use one per thread or per output.
+ *   @isosec, epochsec: The cached second for each format.
+ *   @epochlen: The length of the cached epoch seconds.
+ *   @iso, epoch: The formatted strings.
+ */
+
+struct timefmt_t {
+	int64_t isosec, epochsec;
+
+	uint8_t epochlen;
+	char iso[32], epoch[32];
+};
+
+
+/*
+ * timestamp formatter function declarations
+ */
+
+struct timefmt_t timefmt_init(void);
+
+const char *timefmt_iso8601(struct timefmt_t *fmt, int64_t ns);
+const char *timefmt_epochms(struct timefmt_t *fmt, int64_t ns);
+
+#endif
@@ -2,10 +2,68 @@
 #include "try.h"
 #include "io/output.h"
 #include "io/print.h"
+#include "mem.h"
 #include "res.h"
 #include "string.h"
 
 
+/**
+ * Replay structure.
+ *   @list: The argument list passed to the callbacks, left unused.
+ *   @err: The error record.
+ *   @idx: The index of the next argument.
+ */
+
+struct replay_t {
+	struct arglist_t list;
+	const struct _res_err_t *err;
+	unsigned int idx;
+};
+
+/**
+ * Sink structure.
+ *   @str: The string.
+ *   @len, max: The length and capacity.
+ */
+
+struct sink_t {
+	char *str;
+	size_t len, max;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static _noreturn void vthrow(const char *restrict file, unsigned long line, int code, const char *restrict format, va_list args);
+static bool capture(struct _res_err_t *err, const char *restrict format, va_list args);
+
+static void replay(struct io_output_t output, struct io_print_mod_t *mod, struct arglist_t *list);
+static void invoke(io_print_f callback, struct io_output_t output, struct io_print_mod_t *mod, ...);
+
+static bool sink_ctrl(void *ref, unsigned int id, void *data);
+static void sink_close(void *ref);
+static size_t sink_write(void *ref, const void *restrict buf, size_t nbytes);
+
+/*
+ * local variables
+ */
+
+static struct io_print_t replay_print[] = {
+	{ 'c', NULL, replay },
+	{ 's', NULL, replay },
+	{ 'd', NULL, replay },
+	{ 'i', NULL, replay },
+	{ 'u', NULL, replay },
+	{ 'x', NULL, replay },
+	{ 'p', NULL, replay },
+	{ 'f', NULL, replay },
+	{ 'g', NULL, replay },
+	{ '\0', NULL, NULL }
+};
+
+
 /**
  * Retrieve the jump information from the thread store.
  *   &returns: The jump buffer pointer.
@@ -45,7 +103,8 @@ void nothrow()
 
 
 /**
- * Throw an error, returning to the try branch.
+ * Throw an error, returning to the try branch. The arguments are captured
+ * in the error record and the message is rendered once it is read.
  *   @file: The source file.
  *   @line: The target line.
  *   @format; The format.
@@ -55,27 +114,28 @@ void nothrow()
 _export
 _noreturn void _throw(const char *restrict file, unsigned long line, const char *restrict format, ...)
 {
-	struct res_info_t *info;
 	va_list args;
 
-	info = res_info();
-	if((info == NULL) || info->fatal) {
-		va_start(args, format);
-		_vfatal(file, line, format, args);
-	}
+	va_start(args, format);
+	vthrow(file, line, 0, format, args);
+}
 
-	if(info->error != NULL)
-		free(info->error);
+/**
+ * Throw an error with an error code, returning to the try branch.
+ *   @file: The source file.
+ *   @line: The target line.
+ *   @code: The error code.
+ *   @format; The format.
+ *   @...: The printf-style arguments.
+ */
 
-	va_start(args, format);
-	info->error = malloc(str_vlprintf(format, args) + 1);
-	va_end(args);
+_export
+_noreturn void _throwc(const char *restrict file, unsigned long line, int code, const char *restrict format, ...)
+{
+	va_list args;
 
 	va_start(args, format);
-	str_vprintf(info->error, format, args);
-	va_end(args);
-
-	longjmp(info->jmpbuf, 1);
+	vthrow(file, line, code, format, args);
 }
 
 /**
@@ -88,24 +148,259 @@ _noreturn void _throw(const char *restrict file, unsigned long line, const char
 
 _export
 _noreturn void _vthrow(const char *restrict file, unsigned long line, const char *restrict format, va_list args)
+{
+	vthrow(file, line, 0, format, args);
+}
+
+/**
+ * Render the message of a pending error record into the error string.
+ *   @info: The resource information.
+ */
+
+void _try_render(struct res_info_t *info)
+{
+	struct replay_t replay;
+	struct sink_t sink;
+	static const struct io_output_i iface = { { sink_ctrl, sink_close }, sink_write };
+
+	replay.err = &info->err;
+	replay.idx = 0;
+
+	sink.len = 0;
+	sink.max = 64;
+	sink.str = malloc(sink.max);
+
+	io_vprintf_custom((struct io_output_t){ &sink, &iface }, replay_print, info->err.format, &replay.list);
+	sink.str[sink.len] = '\0';
+
+	info->error = sink.str;
+	info->err.format = NULL;
+}
+
+
+/**
+ * Throw an error. Formats that cannot be captured are rendered immediately.
+ *   @file: The source file.
+ *   @line: The target line.
+ *   @code: The error code.
+ *   @format; The format.
+ *   @args: The variable argument list.
+ */
+
+static _noreturn void vthrow(const char *restrict file, unsigned long line, int code, const char *restrict format, va_list args)
 {
 	struct res_info_t *info;
+	struct _res_err_t *err;
 	va_list copy;
 
 	info = res_info();
 	if((info == NULL) || info->fatal)
 		_vfatal(file, line, format, args);
 
-	if(info->error != NULL)
+	if(info->error != NULL) {
 		free(info->error);
+		info->error = NULL;
+	}
+
+	err = &info->err;
+	err->code = code;
+	err->file = file;
+	err->line = line;
+	err->format = format;
 
 	va_copy(copy, args);
-	info->error = malloc(str_vlprintf(format, args) + 1);
-	str_vprintf(info->error, format, copy);
+	if(!capture(err, format, copy)) {
+		err->format = NULL;
+
+		va_copy(copy, args);
+		info->error = malloc(str_vlprintf(format, copy) + 1);
+		str_vprintf(info->error, format, args);
+	}
 
 	longjmp(info->jmpbuf, 1);
 }
 
+/**
+ * Capture the arguments of a format into an error record. Only plain
+ * scalar and string specifiers are captured.
+ *   @err: The error record.
+ *   @format: The format.
+ *   @args: The arguments.
+ *   &returns: True if captured, false if the format must be rendered now.
+ */
+
+static bool capture(struct _res_err_t *err, const char *restrict format, va_list args)
+{
+	size_t len;
+	const char *str;
+
+	err->nargs = err->nstr = 0;
+
+	while(*format != '\0') {
+		if(*format++ != '%')
+			continue;
+		else if(*format == '%') {
+			format++;
+			continue;
+		}
+
+		if(*format == '-')
+			format++;
+
+		if(*format == '0')
+			format++;
+
+		while(str_isdigit(*format))
+			format++;
+
+		if(*format == '.') {
+			format++;
+			while(str_isdigit(*format))
+				format++;
+		}
+
+		if(err->nargs == RES_NARGS)
+			return false;
+
+		switch(*format) {
+		case 'c':
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+			err->args[err->nargs].i = va_arg(args, int);
+			break;
+
+		case 'f':
+		case 'g':
+			err->args[err->nargs].f = va_arg(args, double);
+			break;
+
+		case 'p':
+			err->args[err->nargs].p = va_arg(args, const void *);
+			break;
+
+		case 's':
+			str = va_arg(args, const char *);
+			len = str_len(str) + 1;
+			if(len > RES_STRLEN - err->nstr)
+				return false;
+
+			mem_copy(err->str + err->nstr, str, len);
+			err->args[err->nargs].p = err->str + err->nstr;
+			err->nstr += len;
+			break;
+
+		default:
+			return false;
+		}
+
+		err->spec[err->nargs++] = *format++;
+	}
+
+	return true;
+}
+
+
+/**
+ * Replay the next captured argument through the default callback.
+ *   @output: The output device.
+ *   @mod: The modifier.
+ *   @list: The argument list, embedded in the replay structure.
+ */
+
+static void replay(struct io_output_t output, struct io_print_mod_t *mod, struct arglist_t *list)
+{
+	unsigned int i;
+	struct io_print_t *print;
+	struct replay_t *replay = getcontainer(list, struct replay_t, list);
+	const struct _res_err_t *err = replay->err;
+
+	i = replay->idx++;
+	for(print = io_print_default; print->ch != err->spec[i]; print++);
+
+	switch(err->spec[i]) {
+	case 'f':
+	case 'g':
+		invoke(print->callback, output, mod, err->args[i].f);
+		break;
+
+	case 'p':
+	case 's':
+		invoke(print->callback, output, mod, err->args[i].p);
+		break;
+
+	default:
+		invoke(print->callback, output, mod, err->args[i].i);
+		break;
+	}
+}
+
+/**
+ * Invoke a print callback with a single argument.
+ *   @callback: The callback.
+ *   @output: The output device.
+ *   @mod: The modifier.
+ *   @...: The argument.
+ */
+
+static void invoke(io_print_f callback, struct io_output_t output, struct io_print_mod_t *mod, ...)
+{
+	struct arglist_t list;
+
+	va_start(list.args, mod);
+	callback(output, mod, &list);
+	va_end(list.args);
+}
+
+
+/**
+ * Handle a control signal for a sink.
+ *   @ref: The reference.
+ *   @id: The control identifier.
+ *   @data: The control data.
+ *   &returns: True if the signal is handle, false otherwise.
+ */
+
+static bool sink_ctrl(void *ref, unsigned int id, void *data)
+{
+	return false;
+}
+
+/**
+ * Close the sink.
+ *   @ref: The reference.
+ */
+
+static void sink_close(void *ref)
+{
+}
+
+/**
+ * Write to a sink, leaving room for the terminating null.
+ *   @ref: The reference.
+ *   @buf: The buffer.
+ *   @nbytes: The number of bytes.
+ *   &returns: The number of bytes written.
+ */
+
+static size_t sink_write(void *ref, const void *restrict buf, size_t nbytes)
+{
+	struct sink_t *sink = ref;
+
+	if(sink->len + nbytes >= sink->max) {
+		while(sink->len + nbytes >= sink->max)
+			sink->max *= 2;
+
+		sink->str = realloc(sink->str, sink->max);
+	}
+
+	mem_copy(sink->str + sink->len, buf, nbytes);
+	sink->len += nbytes;
+
+	return nbytes;
+}
+
 
 /**
  * Fatally abort a program.
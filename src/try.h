@@ -15,6 +15,7 @@ void nothrow();
  */
 
 _noreturn void _throw(const char *restrict file, unsigned long line, const char *restrict format, ...);
+_noreturn void _throwc(const char *restrict file, unsigned long line, int code, const char *restrict format, ...);
 _noreturn void _vthrow(const char *restrict file, unsigned long line, const char *restrict format, va_list args);
 
 _noreturn void _fatal(const char *restrict file, unsigned long line, const char *restrict format, ...);
@@ -28,10 +29,12 @@ _noreturn void _vfatal(const char *restrict file, unsigned long line, const char
 
 #if _test || _debug
 #	define throw(...) _throw(__FILE__, __LINE__, __VA_ARGS__)
+#	define throwc(code, ...) _throwc(__FILE__, __LINE__, code, __VA_ARGS__)
 #	define fatal(...) _fatal(__FILE__, __LINE__, __VA_ARGS__)
 #	define vfatal(format, args) _vfatal(__FILE__, __LINE__, format, args)
 #else
 #	define throw(...) _throw(NULL, 1, __VA_ARGS__)
+#	define throwc(code, ...) _throwc(NULL, 1, code, __VA_ARGS__)
 #	define fatal(...) _fatal(NULL, 1, __VA_ARGS__)
 #	define vfatal(format, args) _vfatal(NULL, 1, format, args)
 #endif
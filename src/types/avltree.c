@@ -3,6 +3,7 @@
 #include "../mem.h"
 #include "../try.h"
 #include "func.h"
+#include "pool.h"
 
 
 /*
@@ -24,7 +25,7 @@ static void *getref(struct avltree_node_t *node, ssize_t offset);
 static struct avltree_node_t *rotate_single(struct avltree_node_t *node, uint8_t dir);
 static struct avltree_node_t *rotate_double(struct avltree_node_t *node, uint8_t dir);
 
-static struct avltree_inst_t *inst_new(const void *key, void *ref, delete_f delete);
+static struct avltree_inst_t *inst_new(struct avltree_t *tree, const void *key, void *ref);
 static void inst_delete(struct avltree_inst_t *inst);
 
 
@@ -458,7 +459,9 @@ struct avltree_node_t *avltree_node_next(struct avltree_node_t *node)
 
 
 /**
- * Initialize an AVL tree.
+ * Initialize an AVL tree. The instance pool is created in the current
+ * scope, so nodes inserted from nested scopes survive until the tree is
+ * destroyed.
  *   @compare: The compare function.
  *   @delete: The deletion function.
  *   &returns: The AVL tree.
@@ -467,18 +470,21 @@ struct avltree_node_t *avltree_node_next(struct avltree_node_t *node)
 _export
 struct avltree_t avltree_init(compare_f compare, delete_f delete)
 {
-	return (struct avltree_t){ avltree_root_init(compare), delete };
+	return (struct avltree_t){ avltree_root_init(compare), delete, pool_new(sizeof(struct avltree_inst_t), false) };
 }
 
 /**
- * Destroy an AVL tree.
+ * Destroy an AVL tree. The instances are released with the pool.
  *   @tree: The tree.
  */
 
 _export
 void avltree_destroy(struct avltree_t *tree)
 {
-	avltree_root_destroy(&tree->root, offsetof(struct avltree_inst_t, node), (delete_f)inst_delete);
+	if(tree->delete != delete_noop)
+		avltree_root_destroy(&tree->root, offsetof(struct avltree_inst_t, node), (delete_f)inst_delete);
+
+	pool_delete(tree->pool);
 }
 
 
@@ -508,7 +514,7 @@ void *avltree_lookup(struct avltree_t *tree, const void *key)
 _export
 void avltree_insert(struct avltree_t *tree, const void *key, void *ref)
 {
-	avltree_root_insert(&tree->root, &inst_new(key, ref, tree->delete)->node);
+	avltree_root_insert(&tree->root, &inst_new(tree, key, ref)->node);
 }
 
 /**
@@ -521,10 +527,19 @@ void avltree_insert(struct avltree_t *tree, const void *key, void *ref)
 _export
 void *avltree_remove(struct avltree_t *tree, const void *key)
 {
+	void *ref;
+	struct avltree_inst_t *inst;
 	struct avltree_node_t *node;
 
 	node = avltree_root_remove(&tree->root, key);
-	return node ? getcontainer(node, struct avltree_inst_t, node)->ref : NULL;
+	if(node == NULL)
+		return NULL;
+
+	inst = getcontainer(node, struct avltree_inst_t, node);
+	ref = inst->ref;
+	pool_free(tree->pool, inst);
+
+	return ref;
 }
 
 
@@ -658,34 +673,33 @@ static struct avltree_node_t *rotate_double(struct avltree_node_t *node, uint8_t
 
 
 /**
- * Create an instance.
+ * Create an instance from the tree's pool.
+ *   @tree: The tree.
  *   @key: The key.
  *   @ref: The reference.
- *   @delete: Deletion.
  *   &returns: The instance.
  */
 
-static struct avltree_inst_t *inst_new(const void *key, void *ref, delete_f delete)
+static struct avltree_inst_t *inst_new(struct avltree_t *tree, const void *key, void *ref)
 {
 	struct avltree_inst_t *inst;
 
-	inst = mem_alloc(sizeof(struct avltree_inst_t));
+	inst = pool_alloc(tree->pool);
 	inst->node = avltree_node_init((void *)key);
 	inst->ref = ref;
-	inst->delete = delete;
+	inst->delete = tree->delete;
 
 	return inst;
 }
 
 /**
- * Delete an instance.
+ * Delete an instance's reference. The instance memory belongs to the pool.
  *   @inst: The instance.
  */
 
 static void inst_delete(struct avltree_inst_t *inst)
 {
 	inst->delete(inst->ref);
-	mem_free(inst);
 }
 
 
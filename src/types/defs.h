@@ -65,12 +65,14 @@ struct avltree_node_t {
  * Generic AVL tree.
  *   @root: The root.
  *   @delete: Deletion function.
+ *   @pool: The instance pool.
  */
 
 struct avltree_t {
 	struct avltree_root_t root;
 
 	delete_f delete;
+	struct pool_t *pool;
 };
 
 /**
@@ -7,6 +7,7 @@
 
 #include "func.h"
 #include "list.h"
+#include "pool.h"
 #include "strbuf.h"
 
 #endif
@@ -0,0 +1,387 @@
+#include "../common.h"
+#include "pool.h"
+#include "../mem.h"
+#include "../posix/inc.h"
+
+
+/*
+ * pool definitions
+ */
+
+#define POOL_LINE	64
+#define POOL_FIRST	4096
+#define POOL_MAX	(1024 * 1024)
+#define POOL_MAG	32
+
+/**
+ * Slab structure. The header is padded to a cache line so that objects
+ * start on a cache line boundary.
+ *   @next: The next slab.
+ *   @base: The unaligned allocation.
+ */
+
+struct slab_t {
+	struct slab_t *next;
+	void *base;
+} __attribute__((aligned(POOL_LINE)));
+
+/**
+ * Magazine structure, caching objects of a shared pool for one thread.
+ *   @pool: The owning pool.
+ *   @prev, next: The previous and next magazines of the pool.
+ *   @cnt: The number of cached objects.
+ *   @obj: The cached objects.
+ */
+
+struct mag_t {
+	struct pool_t *pool;
+	struct mag_t *prev, *next;
+
+	unsigned int cnt;
+	void *obj[POOL_MAG];
+};
+
+/**
+ * Pool structure.
+ *   @size: The object size.
+ *   @shared: The shared flag.
+ *   @lock: The lock, used by shared pools.
+ *   @key, mags: The magazine key and list, used by shared pools.
+ *   @slab: The slab list, most recent first.
+ *   @free: The free list.
+ *   @cur, end: The carving pointer and its limit.
+ *   @cnt: The object count of the next slab.
+ */
+
+struct pool_t {
+	size_t size;
+
+	bool shared;
+	_mutex_t lock;
+	_specific_t key;
+	struct mag_t *mags;
+
+	struct slab_t *slab;
+	void **free;
+	uint8_t *cur, *end;
+	size_t cnt;
+};
+
+
+/*
+ * local function declarations
+ */
+
+static void *pool_take(struct pool_t *pool);
+static void pool_give(struct pool_t *pool, void *ptr);
+static void slab_new(struct pool_t *pool);
+
+static struct mag_t *mag_get(struct pool_t *pool);
+static void mag_delete(void *arg);
+
+
+/**
+ * Create a fixed-size object pool. The pool and its slabs belong to the
+ * current resource scope. A shared pool may be used from any thread, with
+ * each thread caching objects in its own untracked magazine.
+ *   @size: The object size.
+ *   @shared: The shared flag.
+ *   &returns: The pool.
+ */
+
+_export
+struct pool_t *pool_new(size_t size, bool shared)
+{
+	struct pool_t *pool;
+
+	pool = mem_alloc(sizeof(struct pool_t));
+	pool->size = (size < sizeof(void *)) ? sizeof(void *) : ((size + 15) & ~(size_t)15);
+	pool->shared = shared;
+	pool->mags = NULL;
+	pool->slab = NULL;
+	pool->free = NULL;
+	pool->cur = pool->end = NULL;
+	pool->cnt = (POOL_FIRST / pool->size > 0) ? (POOL_FIRST / pool->size) : 1;
+
+	if(shared) {
+		pool->lock = _mutex_init();
+		pool->key = _specific_alloc(mag_delete);
+	}
+
+	return pool;
+}
+
+/**
+ * Delete a pool, releasing all objects at once.
+ *   @pool: The pool.
+ */
+
+_export
+void pool_delete(struct pool_t *pool)
+{
+	struct mag_t *mag;
+	struct slab_t *slab;
+
+	if(pool->shared) {
+		_specific_free(pool->key);
+		_mutex_destroy(&pool->lock);
+
+		while(pool->mags != NULL) {
+			mag = pool->mags;
+			pool->mags = mag->next;
+			mem_free_untracked(mag);
+		}
+	}
+
+	while(pool->slab != NULL) {
+		slab = pool->slab;
+		pool->slab = slab->next;
+		mem_free(slab->base);
+	}
+
+	mem_free(pool);
+}
+
+
+/**
+ * Allocate an object from the pool.
+ *   @pool: The pool.
+ *   &returns: The object.
+ */
+
+_export
+void *pool_alloc(struct pool_t *pool)
+{
+	void *ptr;
+	struct mag_t *mag;
+
+	if(!pool->shared)
+		return pool_take(pool);
+
+	mag = mag_get(pool);
+	if(mag->cnt > 0)
+		return mag->obj[--mag->cnt];
+
+	_mutex_lock(&pool->lock);
+
+	while(mag->cnt < POOL_MAG / 2)
+		mag->obj[mag->cnt++] = pool_take(pool);
+
+	ptr = pool_take(pool);
+
+	_mutex_unlock(&pool->lock);
+
+	return ptr;
+}
+
+/**
+ * Return an object to the pool.
+ *   @pool: The pool.
+ *   @ptr: The object.
+ */
+
+_export
+void pool_free(struct pool_t *pool, void *ptr)
+{
+	struct mag_t *mag;
+
+	if(!pool->shared)
+		return pool_give(pool, ptr);
+
+	mag = mag_get(pool);
+	if(mag->cnt == POOL_MAG) {
+		_mutex_lock(&pool->lock);
+
+		while(mag->cnt > POOL_MAG / 2)
+			pool_give(pool, mag->obj[--mag->cnt]);
+
+		_mutex_unlock(&pool->lock);
+	}
+
+	mag->obj[mag->cnt++] = ptr;
+}
+
+/**
+ * Reset the pool, releasing all objects. The most recent slab is kept for
+ * reuse. A shared pool must not be in use by other threads.
+ *   @pool: The pool.
+ */
+
+_export
+void pool_reset(struct pool_t *pool)
+{
+	struct mag_t *mag;
+	struct slab_t *slab;
+
+	if(pool->shared) {
+		for(mag = pool->mags; mag != NULL; mag = mag->next)
+			mag->cnt = 0;
+	}
+
+	pool->free = NULL;
+	if(pool->slab == NULL)
+		return;
+
+	while(pool->slab->next != NULL) {
+		slab = pool->slab->next;
+		pool->slab->next = slab->next;
+		mem_free(slab->base);
+	}
+
+	pool->cur = (uint8_t *)(pool->slab + 1);
+}
+
+/**
+ * Trim the pool, releasing all of its slabs. No object may be in use, and a
+ * shared pool must not be in use by other threads.
+ *   @pool: The pool.
+ */
+
+_export
+void pool_trim(struct pool_t *pool)
+{
+	struct mag_t *mag;
+	struct slab_t *slab;
+
+	if(pool->shared) {
+		for(mag = pool->mags; mag != NULL; mag = mag->next)
+			mag->cnt = 0;
+	}
+
+	while(pool->slab != NULL) {
+		slab = pool->slab;
+		pool->slab = slab->next;
+		mem_free(slab->base);
+	}
+
+	pool->free = NULL;
+	pool->cur = pool->end = NULL;
+	pool->cnt = (POOL_FIRST / pool->size > 0) ? (POOL_FIRST / pool->size) : 1;
+}
+
+
+/**
+ * Take an object from the free list or the current slab.
+ *   @pool: The pool, locked if shared.
+ *   &returns: The object.
+ */
+
+static void *pool_take(struct pool_t *pool)
+{
+	void *ptr;
+
+	if(pool->free != NULL) {
+		ptr = pool->free;
+		pool->free = *pool->free;
+
+		return ptr;
+	}
+
+	if(pool->cur + pool->size > pool->end)
+		slab_new(pool);
+
+	ptr = pool->cur;
+	pool->cur += pool->size;
+
+	return ptr;
+}
+
+/**
+ * Place an object on the free list.
+ *   @pool: The pool, locked if shared.
+ *   @ptr: The object.
+ */
+
+static void pool_give(struct pool_t *pool, void *ptr)
+{
+	*(void **)ptr = pool->free;
+	pool->free = ptr;
+}
+
+/**
+ * Add a new slab to the pool. Each slab holds twice as many objects as the
+ * previous one, up to 'POOL_MAX' bytes.
+ *   @pool: The pool, locked if shared.
+ */
+
+static void slab_new(struct pool_t *pool)
+{
+	void *base;
+	struct slab_t *slab;
+	size_t nbytes = pool->cnt * pool->size;
+
+	base = mem_alloc(sizeof(struct slab_t) + nbytes + POOL_LINE - 1);
+	slab = (void *)(((uintptr_t)base + POOL_LINE - 1) & ~(uintptr_t)(POOL_LINE - 1));
+	slab->base = base;
+	slab->next = pool->slab;
+	pool->slab = slab;
+
+	pool->cur = (uint8_t *)(slab + 1);
+	pool->end = pool->cur + nbytes;
+
+	if(2 * nbytes <= POOL_MAX)
+		pool->cnt *= 2;
+}
+
+
+/**
+ * Retrieve the magazine of the current thread, creating it if needed.
+ *   @pool: The shared pool.
+ *   &returns: The magazine.
+ */
+
+static struct mag_t *mag_get(struct pool_t *pool)
+{
+	struct mag_t *mag;
+
+	mag = _specific_get(pool->key);
+	if(mag != NULL)
+		return mag;
+
+	mag = mem_alloc_untracked(sizeof(struct mag_t));
+	mag->pool = pool;
+	mag->cnt = 0;
+	mag->prev = NULL;
+
+	_mutex_lock(&pool->lock);
+
+	mag->next = pool->mags;
+	if(pool->mags != NULL)
+		pool->mags->prev = mag;
+
+	pool->mags = mag;
+
+	_mutex_unlock(&pool->lock);
+
+	_specific_set(pool->key, mag);
+
+	return mag;
+}
+
+/**
+ * Delete a magazine when its thread exits, returning its objects.
+ *   @arg: The magazine.
+ */
+
+static void mag_delete(void *arg)
+{
+	struct mag_t *mag = arg;
+	struct pool_t *pool = mag->pool;
+
+	_mutex_lock(&pool->lock);
+
+	while(mag->cnt > 0)
+		pool_give(pool, mag->obj[--mag->cnt]);
+
+	if(mag->prev != NULL)
+		mag->prev->next = mag->next;
+	else
+		pool->mags = mag->next;
+
+	if(mag->next != NULL)
+		mag->next->prev = mag->prev;
+
+	_mutex_unlock(&pool->lock);
+
+	mem_free_untracked(mag);
+}
@@ -0,0 +1,16 @@
+#ifndef TYPES_POOL_H
+#define TYPES_POOL_H
+
+/*
+ * pool function declarations
+ */
+
+struct pool_t *pool_new(size_t size, bool shared);
+void pool_delete(struct pool_t *pool);
+
+void *pool_alloc(struct pool_t *pool);
+void pool_free(struct pool_t *pool, void *ptr);
+void pool_reset(struct pool_t *pool);
+void pool_trim(struct pool_t *pool);
+
+#endif
@@ -122,7 +122,7 @@ void strbuf_append(struct strbuf_t *buf, const char *restrict str)
 _export
 void strbuf_write(struct strbuf_t *buf, const char *restrict data, size_t nbytes)
 {
-	unsigned int i, len;
+	size_t i, len;
 
 	i = buf->i + nbytes;
 	if(i >= buf->len) {
@@ -7,6 +7,7 @@ HEADERS = \
 	src/posix/dir.h \
 	src/posix/dynlib.h \
 	src/posix/err.h \
+	src/posix/event.h \
 	src/posix/file.h \
 	src/posix/fs.h \
 	src/posix/net.h \
@@ -21,25 +22,36 @@ HEADERS = \
 	src/complex.h \
 	src/dtoa.h \
 	src/dynlib.h \
+	src/fiber.h \
 	src/fs.h \
+	src/future.h \
+	src/lockprof.h \
+	src/log.h \
 	src/math.h \
 	src/mem.h \
+	src/par.h \
+	src/prof.h \
 	src/res.h \
 	src/string.h \
+	src/thrpool.h \
+	src/timefmt.h \
 	src/try.h \
 	\
 	src/types/avltree.h \
 	src/types/func.h \
 	src/types/list.h \
+	src/types/pool.h \
 	src/types/strbuf.h \
 	\
 	src/io/chunk.h \
+	src/io/codec.h \
 	src/io/device.h \
 	src/io/input.h \
 	src/io/output.h \
 	src/io/parse.h \
 	src/io/print.h \
 	src/io/reader.h \
+	src/io/serial.h \
 	src/io/string.h \
 	src/io/wrap.h \
 	\